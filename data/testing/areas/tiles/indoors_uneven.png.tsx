@@ -0,0 +1,22 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<tileset name="indoors_uneven.png" tilewidth="16" tileheight="16">
+ <image source="areas/tiles/indoors_uneven.png" width="120" height="200"/>
+ <tile id="13">
+  <properties>
+   <property name="frames" value="13,20"/>
+   <property name="speed" value="1.5"/>
+  </properties>
+ </tile>
+ <tile id="27">
+  <properties>
+   <property name="frames" value="27,34"/>
+   <property name="speed" value="1.5"/>
+  </properties>
+ </tile>
+ <tile id="41">
+  <properties>
+   <property name="frames" value="41,48"/>
+   <property name="speed" value="1.5"/>
+  </properties>
+ </tile>
+</tileset>
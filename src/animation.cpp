@@ -25,6 +25,7 @@
 // **********
 
 #include <cassert>
+#include <math.h>
 
 #include <Gosu/Graphics.hpp>
 
@@ -71,6 +72,23 @@ void Animation::startOver(time_t now, int cycles)
 	frameShowing = 0;
 }
 
+bool Animation::isAnimated() const
+{
+	return frames.size() > 1;
+}
+
+ImageOpacity Animation::opacity() const
+{
+	if (frames.empty())
+		return IMAGE_TRANSPARENT;
+
+	ImageOpacity first = frames[0]->opacity();
+	for (size_t i = 1; i < frames.size(); i++)
+		if (frames[i]->opacity() != first)
+			return IMAGE_MIXED;
+	return first;
+}
+
 bool Animation::needsRedraw(time_t now) const
 {
 	if (cycles) {
@@ -81,6 +99,18 @@ bool Animation::needsRedraw(time_t now) const
 	return false;
 }
 
+time_t Animation::nextFrameTime(time_t now) const
+{
+	if (cycles == 0 || frames.size() < 2)
+		return ANIM_NEVER;
+
+	time_t pos = now - offset;
+	time_t next = (pos / frameTime + 1) * frameTime;
+	if (cycles != ANIM_INFINITE_CYCLES && next >= cycles * cycleTime)
+		return ANIM_NEVER;
+	return offset + next;
+}
+
 Image* Animation::frame(time_t now)
 {
 	if (frames.size() == 0)
@@ -99,3 +129,92 @@ Image* Animation::frame(time_t now)
 	return frames[frameShowing].get();
 }
 
+
+size_t AnimationClock::add(const Animation* anim)
+{
+	double offset = (double)anim->offset;
+	double lastFrame = HUGE_VAL;
+	if (anim->cycles == 0) {
+		// Stopped. Pretend it finished playing long ago.
+		offset = -HUGE_VAL;
+		lastFrame = (double)anim->frameShowing;
+	}
+	else if (anim->cycles != ANIM_INFINITE_CYCLES)
+		lastFrame = (double)anim->cycles * (double)anim->frames.size() - 1;
+
+	anims.push_back(anim);
+	offsets.push_back(offset);
+	frameTimes.push_back((double)anim->frameTime);
+	frameCounts.push_back((double)anim->frames.size());
+	lastFrames.push_back(lastFrame);
+	frameIdxs.push_back(0.0);
+	nextTimes.push_back(HUGE_VAL);
+	images.push_back(NULL);
+	changes.push_back(true);
+	return anims.size() - 1;
+}
+
+void AnimationClock::clear()
+{
+	anims.clear();
+	offsets.clear();
+	frameTimes.clear();
+	frameCounts.clear();
+	lastFrames.clear();
+	frameIdxs.clear();
+	nextTimes.clear();
+	images.clear();
+	changes.clear();
+}
+
+size_t AnimationClock::size() const
+{
+	return anims.size();
+}
+
+void AnimationClock::tick(time_t now)
+{
+	const size_t n = anims.size();
+	const double t = (double)now;
+
+	const double* offset = offsets.data();
+	const double* frameTime = frameTimes.data();
+	const double* count = frameCounts.data();
+	const double* last = lastFrames.data();
+	double* idx = frameIdxs.data();
+	double* next = nextTimes.data();
+
+	// Keep this loop free of branches and calls so it vectorizes. All
+	// values are whole milliseconds, so the divisions are exact where it
+	// matters: on frame boundaries.
+	for (size_t i = 0; i < n; i++) {
+		double pos = t - offset[i];
+		double elapsed = floor(pos / frameTime[i]); // frames shown so far
+		double k = elapsed < last[i] ? elapsed : last[i];
+		idx[i] = k - floor(k / count[i]) * count[i];
+		next[i] = k < last[i] ?
+			offset[i] + (k + 1.0) * frameTime[i] : HUGE_VAL;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		Image* img = anims[i]->frames[(size_t)idx[i]].get();
+		changes[i] = img != images[i];
+		images[i] = img;
+	}
+}
+
+Image* AnimationClock::frame(size_t slot) const
+{
+	return images[slot];
+}
+
+time_t AnimationClock::nextFrameTime(size_t slot) const
+{
+	double next = nextTimes[slot];
+	return next == HUGE_VAL ? ANIM_NEVER : (time_t)next;
+}
+
+bool AnimationClock::changed(size_t slot) const
+{
+	return changes[slot] != 0;
+}
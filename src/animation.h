@@ -28,6 +28,7 @@
 #ifndef ANIMATED_H
 #define ANIMATED_H
 
+#include <limits>
 #include <vector>
 
 #include "image.h"
@@ -35,6 +36,9 @@
 
 #define ANIM_INFINITE_CYCLES -1
 
+//! Returned by Animation::nextFrameTime() when the frame will never change.
+#define ANIM_NEVER std::numeric_limits<time_t>::max()
+
 /**
  * An Animation is a sequence of bitmap images (called frames) used to creates
  * the illusion of motion. Frames are cycled over with an even amount of time
@@ -84,6 +88,18 @@ public:
 	 */
 	void startOver(time_t now, int cycles);
 
+	/**
+	 * Does this Animation have more than one frame? Animations that don't
+	 * never change and can be drawn from a pre-rendered cache.
+	 */
+	bool isAnimated() const;
+
+	/**
+	 * IMAGE_OPAQUE or IMAGE_TRANSPARENT if every frame is, otherwise
+	 * IMAGE_MIXED.
+	 */
+	ImageOpacity opacity() const;
+
 	/**
 	 * Has this Animation switched frames since frame() was last called?
 	 *
@@ -91,6 +107,15 @@ public:
 	 */
 	bool needsRedraw(time_t now) const;
 
+	/**
+	 * Returns the time at which the next frame will be shown, or
+	 * ANIM_NEVER if this Animation is static or on its last frame for
+	 * good.
+	 *
+	 * @now current time in milliseconds
+	 */
+	time_t nextFrameTime(time_t now) const;
+
 	/**
 	 * Returns the image that should be displayed at this time.
 	 *
@@ -125,6 +150,64 @@ private:
 
 	/** Time offset to find current animation frame. */
 	time_t offset;
+
+	friend class AnimationClock;
+};
+
+/**
+ * Resolves the current frame of many Animations at once. Instead of asking
+ * each Animation for its frame every time it is drawn, the clock is ticked
+ * once per frame and the results are read back from a table.
+ *
+ * Timing parameters are kept in flat arrays so that the per-tick math runs
+ * as one branch-free loop the compiler can vectorize.
+ *
+ * The clock copies an Animation's timing when it is added. If the Animation
+ * is started over, the clock must be rebuilt.
+ */
+class AnimationClock
+{
+public:
+	//! Add an animation. Returns the slot to look up its frame with.
+	size_t add(const Animation* anim);
+
+	//! Forget all Animations.
+	void clear();
+
+	//! Number of Animations on the clock.
+	size_t size() const;
+
+	/**
+	 * Resolve the frame every Animation is showing.
+	 *
+	 * @now current time in milliseconds
+	 */
+	void tick(time_t now);
+
+	//! The image an Animation was showing at the last tick.
+	Image* frame(size_t slot) const;
+
+	//! Like Animation::nextFrameTime(), as of the last tick.
+	time_t nextFrameTime(size_t slot) const;
+
+	//! Did the last tick switch an Animation to a different image than
+	//! the tick before?
+	bool changed(size_t slot) const;
+
+private:
+	std::vector<const Animation*> anims;
+
+	// Timing, one entry per Animation.
+	std::vector<double> offsets;
+	std::vector<double> frameTimes;
+	std::vector<double> frameCounts;
+	std::vector<double> lastFrames; //!< Frames until stopping, or HUGE_VAL.
+
+	// Results of the last tick.
+	std::vector<double> frameIdxs;
+	std::vector<double> nextTimes; //!< HUGE_VAL if never.
+	std::vector<Image*> images;
+	std::vector<char> changes;
 };
 
 #endif
@@ -0,0 +1,306 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** area-binary.cpp                    **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <future>
+
+#include <Gosu/Color.hpp>
+
+#include "area-binary.h"
+#include "formatter.h"
+#include "log.h"
+#include "reader.h"
+#include "string.h"
+#include "world.h"
+
+#define ASSERT(x)  if (!(x)) { return false; }
+
+AreaBinary* AreaBinary::open(Viewport* view, Player* player,
+		const std::string& filename)
+{
+	std::string path = filename + COMPILED_AREA_SUFFIX;
+	if (!Reader::fileExists(path))
+		return NULL;
+
+	std::string data = Reader::readString(path);
+	AreaBinary* area = new AreaBinary(view, player, filename);
+	if (!readCompiledArea(path, data.data(), data.size(), area->compiled)) {
+		delete area;
+		return NULL;
+	}
+	if (!area->fresh()) {
+		Log::info(path, "out of date, reading " + filename + " instead");
+		delete area;
+		return NULL;
+	}
+	return area;
+}
+
+AreaBinary::AreaBinary(Viewport* view,
+           Player* player,
+           const std::string& descriptor)
+	: Area(view, player, descriptor)
+{
+	// Add TileType #0. Not used, but Tiled's gids start from 1.
+	gids.push_back(NULL);
+}
+
+AreaBinary::~AreaBinary()
+{
+}
+
+bool AreaBinary::init()
+{
+	dim = ivec3(compiled.width, compiled.height, 0);
+	tileDim = ivec2(compiled.tileWidth, compiled.tileHeight);
+	scripts.resize(compiled.strings.size());
+
+	ASSERT(processProperties());
+	ASSERT(processTileSets());
+	ASSERT(processLayers());
+	ASSERT(processRegions());
+
+	// Everything has been copied out.
+	compiled = CompiledArea();
+	scripts.clear();
+	return true;
+}
+
+bool AreaBinary::fresh() const
+{
+	for (size_t i = 0; i < compiled.sources.size(); i++) {
+		const CompiledArea::Source& source = compiled.sources[i];
+		std::string text = Reader::getText(source.name);
+		if (text.empty() || hashString(text) != source.hash)
+			return false;
+	}
+	return true;
+}
+
+bool AreaBinary::processProperties()
+{
+	name = stringAt(compiled.name);
+	musicIntroSet = compiled.introMusic != NO_STRING;
+	musicIntro = stringAt(compiled.introMusic);
+	musicLoopSet = compiled.loopMusic != NO_STRING;
+	musicLoop = stringAt(compiled.loopMusic);
+
+	ASSERT(script(compiled.loadScript, &loadScript));
+	ASSERT(script(compiled.focusScript, &focusScript));
+	ASSERT(script(compiled.tickScript, &tickScript));
+	ASSERT(script(compiled.turnScript, &turnScript));
+
+	loopX = compiled.loopX != 0;
+	loopY = compiled.loopY != 0;
+	if (compiled.hasColorOverlay)
+		colorOverlay = Gosu::Color(compiled.colorOverlay);
+
+	for (int32_t z = 0; z < compiled.depth; z++) {
+		double depth = compiled.depths[z];
+		depth2idx[depth] = z;
+		idx2depth.push_back(depth);
+		allocateMapLayer();
+	}
+	return true;
+}
+
+bool AreaBinary::processTileSets()
+{
+	std::vector<std::shared_future<TiledImageRef> > loads;
+	for (size_t i = 0; i < compiled.tileSets.size(); i++)
+		loads.push_back(Reader::getTiledImageAsync(
+			stringAt(compiled.tileSets[i].image),
+			tileDim.x, tileDim.y));
+
+	for (size_t i = 0; i < compiled.tileSets.size(); i++) {
+		const CompiledArea::TileSet& compiledSet = compiled.tileSets[i];
+		const std::string& source = stringAt(compiledSet.image);
+
+		TiledImageRef img = loads[i].get();
+		if (!img) {
+			Log::err(descriptor, "tileset image not found");
+			return false;
+		}
+		size_t size = (size_t)(compiledSet.width * compiledSet.height);
+		if (img->size() != size) {
+			Log::err(descriptor, source + ": tileset image's "
+				"size doesn't match its <image> element");
+			return false;
+		}
+		tileSheets.push_back(img);
+
+		tileSets[source] = TileSet(compiledSet.width,
+		                           compiledSet.height);
+		TileSet& set = tileSets[source];
+		for (size_t j = 0; j < size; j++) {
+			TileType* type = new TileType((*img.get())[j]);
+			set.add(type);
+			gids.push_back(type);
+		}
+	}
+
+	for (size_t i = 0; i < compiled.tileTypes.size(); i++)
+		ASSERT(processTileType(compiled.tileTypes[i]));
+	return true;
+}
+
+bool AreaBinary::processTileType(const CompiledArea::TileType& compiledType)
+{
+	const std::string& source = stringAt(
+		compiled.tileSets[compiledType.tileSet].image);
+	TiledImageRef& img = tileSheets[compiledType.tileSet];
+	int tiles = (int)img->size();
+
+	if (compiledType.id < 0 || tiles <= compiledType.id ||
+	    compiledType.gid <= 0 || (int)gids.size() <= compiledType.gid) {
+		Log::err(descriptor, "tile type id is invalid");
+		return false;
+	}
+
+	TileType* type = new TileType((*img.get())[compiledType.id]);
+	type->flags = compiledType.flags;
+	ASSERT(script(compiledType.enterScript, &type->enterScript));
+	ASSERT(script(compiledType.leaveScript, &type->leaveScript));
+	ASSERT(script(compiledType.useScript, &type->useScript));
+
+	if (compiledType.frameLen != -1) {
+		std::vector<ImageRef> frames;
+		for (size_t i = 0; i < compiledType.frames.size(); i++) {
+			int idx = compiledType.frames[i];
+			if (idx < 0 || tiles <= idx) {
+				Log::err(descriptor, "frame index out "
+					"of range for animated tile");
+				delete type;
+				return false;
+			}
+			frames.push_back((*img.get())[idx]);
+		}
+		time_t now = World::instance()->time();
+		type->anim = Animation(frames, compiledType.frameLen);
+		type->anim.startOver(now, compiledType.cycles);
+	}
+
+	delete gids[compiledType.gid]; // "vanilla" type
+	gids[compiledType.gid] = type;
+	tileSets[source].set(compiledType.id, type);
+	return true;
+}
+
+bool AreaBinary::processLayers()
+{
+	size_t i = 0;
+	for (int z = 0; z < dim.z; z++) {
+		for (int y = 0; y < dim.y; y++) {
+			row_t& row = map[z][y];
+			for (int x = 0; x < dim.x; x++, i++) {
+				int gid = compiled.gids[i];
+				if (gid < 0 || (int)gids.size() <= gid) {
+					Log::err(descriptor, "invalid tile gid");
+					return false;
+				}
+
+				Tile& tile = row[x];
+				tile.flags = compiled.flags[i];
+				if (gid > 0) {
+					TileType* type = gids[gid];
+					type->allOfType.push_back(&tile);
+					tile.parent = type;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool AreaBinary::processRegions()
+{
+	for (size_t i = 0; i < compiled.scripts.size(); i++) {
+		const CompiledArea::ScriptRegion& region = compiled.scripts[i];
+		const CompiledArea::Region& r = region.r;
+		ScriptRef enterScript, leaveScript, useScript;
+		ASSERT(script(region.enterScript, &enterScript));
+		ASSERT(script(region.leaveScript, &leaveScript));
+		ASSERT(script(region.useScript, &useScript));
+		for (int y = r.y; y < r.y + r.h; y++) {
+			for (int x = r.x; x < r.x + r.w; x++) {
+				Tile& tile = map[r.z][y][x];
+				tile.enterScript = enterScript;
+				tile.leaveScript = leaveScript;
+				tile.useScript = useScript;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < compiled.exits.size(); i++) {
+		const CompiledArea::ExitRegion& exit = compiled.exits[i];
+		const CompiledArea::Region& r = exit.r;
+		const std::string& area = stringAt(exit.area);
+
+		// Have it ready in case the player goes there.
+		Reader::getTextAsync(area, READ_PREFETCH);
+
+		for (int y = r.y; y < r.y + r.h; y++) {
+			for (int x = r.x; x < r.x + r.w; x++) {
+				int dx = exit.wwide ? x - r.x : 0;
+				int dy = exit.hwide ? y - r.y : 0;
+				map[r.z][y][x].exits[exit.dir] = new Exit(area,
+					exit.x + dx, exit.y + dy, exit.z);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < compiled.layermods.size(); i++) {
+		const CompiledArea::LayermodRegion& layermod =
+			compiled.layermods[i];
+		const CompiledArea::Region& r = layermod.r;
+		for (int y = r.y; y < r.y + r.h; y++)
+			for (int x = r.x; x < r.x + r.w; x++)
+				map[r.z][y][x].layermods[layermod.dir] =
+					new double(layermod.mod);
+	}
+	return true;
+}
+
+const std::string& AreaBinary::stringAt(int32_t idx) const
+{
+	static const std::string none;
+	return idx == NO_STRING ? none : compiled.strings[idx];
+}
+
+bool AreaBinary::script(int32_t idx, ScriptRef* script)
+{
+	if (idx == NO_STRING)
+		return true;
+	if (!scripts[idx]) {
+		ScriptRef loaded = Script::create(compiled.strings[idx]);
+		if (!loaded || !loaded->validate())
+			return false;
+		scripts[idx] = loaded;
+	}
+	*script = scripts[idx];
+	return true;
+}
+
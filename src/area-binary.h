@@ -0,0 +1,89 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** area-binary.h                      **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef AREA_BINARY_H
+#define AREA_BINARY_H
+
+#include <string>
+#include <vector>
+
+#include "area.h"
+#include "compiled-area.h"
+#include "tile.h"
+
+class Viewport;
+class Player;
+
+//! An Area built from a CompiledArea: read from tsunagari-compile's copy by
+//! open(), or parsed from the TMX by AreaTMX.
+/*!
+	Everything was parsed and checked when the CompiledArea was made.
+	Building the Area is a matter of copying tile planes and tables into
+	place, with no XML involved.
+*/
+class AreaBinary : public Area
+{
+public:
+	//! Open the compiled copy of an Area. NULL if there is none, or if
+	//! the TMX or TSX files it was made from have changed since.
+	static AreaBinary* open(Viewport* view, Player* player,
+		const std::string& filename);
+
+	virtual ~AreaBinary();
+
+	//! Build the Area from compiled.
+	virtual bool init();
+
+protected:
+	AreaBinary(Viewport* view, Player* player, const std::string& filename);
+
+	CompiledArea compiled;
+
+private:
+	//! Do the sources' hashes match the files in the World?
+	bool fresh() const;
+
+	bool processProperties();
+	bool processTileSets();
+	bool processTileType(const CompiledArea::TileType& compiledType);
+	bool processLayers();
+	bool processRegions();
+
+	//! Name for a string index, or "" for NO_STRING.
+	const std::string& stringAt(int32_t idx) const;
+
+	//! Load each script once, however many Tiles refer to it.
+	bool script(int32_t idx, ScriptRef* script);
+
+	//! Scripts loaded so far, by string index.
+	std::vector<ScriptRef> scripts;
+
+	std::vector<TileType*> gids;
+};
+
+#endif
+
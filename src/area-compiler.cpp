@@ -0,0 +1,235 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** area-compiler.cpp                  **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+/*
+ * tsunagari-compile: compile Areas ahead of time.
+ *
+ * Reads an Area's TMX file and the TSX files it uses with the same TMXParser
+ * as AreaTMX, and writes out everything they describe as a CompiledArea
+ * next to the TMX. The engine loads that instead, without parsing any XML,
+ * for as long as the TMX and TSX files are unchanged.
+ *
+ * Files are looked up under each directory given, in order, just as the
+ * engine looks in the World and then in its base data. DTDs are only read
+ * from the base data.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <libxml/parser.h>
+
+#include "compiled-area.h"
+#include "formatter.h"
+#include "log.h"
+#include "tmx-parser.h"
+#include "xml.h"
+
+#define ASSERT(x)  if (!(x)) { return false; }
+
+/*
+ * Log reports through the World and Python in the engine. Here there is
+ * only the terminal.
+ */
+
+void Log::info(std::string domain, std::string msg)
+{
+	std::cout << "Info [" << domain << "] - " << msg << std::endl;
+}
+
+void Log::err(std::string domain, std::string msg)
+{
+	std::cerr << "Error [" << domain << "] - " << msg << std::endl;
+}
+
+void Log::fatal(std::string domain, std::string msg)
+{
+	std::cerr << "Fatal [" << domain << "] - " << msg << std::endl;
+}
+
+class AreaCompiler : public TMXParser
+{
+public:
+	AreaCompiler(const std::vector<std::string>& roots);
+	~AreaCompiler();
+
+	//! Compile one Area. The compiled copy is written under the first
+	//! directory.
+	bool compile(const std::string& descriptor);
+
+protected:
+	virtual XMLStream* streamArea(const std::string& name);
+	virtual XMLRef getTileSet(const std::string& name);
+
+private:
+	//! Read name from the first directory that has it, or only from the
+	//! base directory, the last one, if baseOnly is set.
+	bool readFile(const std::string& name, std::string* data,
+		bool baseOnly = false);
+	//! DTDs come from the base directory only, as in the engine, so that
+	//! a World can't loosen the checks on its own Areas.
+	xmlDtd* getDTD(const std::string& name);
+
+	std::vector<std::string> roots;
+	std::map<std::string, xmlDtd*> dtds;
+};
+
+AreaCompiler::AreaCompiler(const std::vector<std::string>& roots)
+	: roots(roots)
+{
+}
+
+AreaCompiler::~AreaCompiler()
+{
+	std::map<std::string, xmlDtd*>::iterator it;
+	for (it = dtds.begin(); it != dtds.end(); it++)
+		if (it->second)
+			xmlFreeDtd(it->second);
+}
+
+bool AreaCompiler::compile(const std::string& descriptor)
+{
+	CompiledArea area;
+	ASSERT(parse(descriptor, area));
+
+	std::string path = roots[0] + "/" + descriptor + COMPILED_AREA_SUFFIX;
+	std::string data = writeCompiledArea(area);
+	std::ofstream out(path.c_str(), std::ios::out | std::ios::binary);
+	out.write(data.data(), (std::streamsize)data.size());
+	out.close();
+	if (!out) {
+		Log::err(path, "could not write compiled Area");
+		return false;
+	}
+	Log::info(path, Formatter("% bytes") % (long)data.size());
+	return true;
+}
+
+XMLStream* AreaCompiler::streamArea(const std::string& name)
+{
+	std::string data;
+	xmlDtd* dtd = getDTD("dtd/area.dtd");
+	if (!dtd || !readFile(name, &data))
+		return NULL;
+
+	XMLStream* stream = new XMLStream;
+	if (!stream->init(name, data, dtd)) {
+		delete stream;
+		return NULL;
+	}
+	addSource(name, data);
+	return stream;
+}
+
+XMLRef AreaCompiler::getTileSet(const std::string& name)
+{
+	std::string data;
+	xmlDtd* dtd = getDTD("dtd/tsx.dtd");
+	if (!dtd || !readFile(name, &data))
+		return XMLRef();
+
+	XMLRef doc(new XMLDoc);
+	if (!doc->init(name, data, dtd))
+		return XMLRef();
+	addSource(name, data);
+	return doc;
+}
+
+bool AreaCompiler::readFile(const std::string& name, std::string* data,
+		bool baseOnly)
+{
+	size_t first = baseOnly ? roots.size() - 1 : 0;
+	for (size_t i = first; i < roots.size(); i++) {
+		std::ifstream in((roots[i] + "/" + name).c_str(),
+		                 std::ios::in | std::ios::binary);
+		if (in) {
+			std::ostringstream bytes;
+			bytes << in.rdbuf();
+			*data = bytes.str();
+			return true;
+		}
+	}
+	Log::err(name, "file not found");
+	return false;
+}
+
+xmlDtd* AreaCompiler::getDTD(const std::string& name)
+{
+	std::map<std::string, xmlDtd*>::iterator it = dtds.find(name);
+	if (it != dtds.end())
+		return it->second;
+
+	xmlDtd* dtd = NULL;
+	std::string bytes;
+	if (readFile(name, &bytes, true)) {
+		xmlCharEncoding enc = XML_CHAR_ENCODING_NONE;
+		xmlParserInputBuffer* input = xmlParserInputBufferCreateMem(
+				bytes.c_str(), (int)bytes.size(), enc);
+		if (input)
+			dtd = xmlIOParseDTD(NULL, input, enc);
+		if (!dtd)
+			Log::err(name, "could not parse DTD");
+	}
+	return dtds[name] = dtd;
+}
+
+static void usage()
+{
+	std::cerr << "usage: tsunagari-compile WORLD-DIR BASE-DIR AREA..."
+		<< std::endl;
+	std::cerr << "Compiles each AREA, a TMX file under WORLD-DIR. The DTDs"
+		" are read from" << std::endl;
+	std::cerr << "BASE-DIR." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4) {
+		usage();
+		return 1;
+	}
+
+	LIBXML_TEST_VERSION
+
+	std::vector<std::string> roots;
+	roots.push_back(argv[1]);
+	roots.push_back(argv[2]);
+
+	int failed = 0;
+	{
+		AreaCompiler compiler(roots);
+		for (int i = 3; i < argc; i++)
+			if (!compiler.compile(argv[i]))
+				failed++;
+	}
+
+	xmlCleanupParser();
+	return failed ? 1 : 0;
+}
+
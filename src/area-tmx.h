@@ -24,19 +24,26 @@
 // IN THE SOFTWARE.
 // **********
 
+
 #ifndef AREA_TMX_H
 #define AREA_TMX_H
 
 #include <string>
 
-#include "area.h"
-#include "tile.h"
-#include "xml.h"
+#include "area-binary.h"
 
 class Viewport;
 class Player;
 
-class AreaTMX : public Area
+//! An Area read from its TMX file, for when there is no up-to-date compiled
+//! copy.
+/*!
+	The TMX and TSX files are parsed into a CompiledArea just as
+	tsunagari-compile would, with tileset images and encoded layers
+	decoded on other threads as they are read. AreaBinary builds the Area
+	from that.
+*/
+class AreaTMX : public AreaBinary
 {
 public:
 	AreaTMX(Viewport* view, Player* player, const std::string& filename);
@@ -45,33 +52,6 @@ public:
 	//! Parse the file specified in the constructor, generating a full Area
 	//! object. Must be called before use.
 	virtual bool init();
-
-private:
-	//! Allocate Tile objects for one layer of map.
-	void allocateMapLayer();
-
-	//! Parse an Area file.
-	bool processDescriptor();
-	bool processMapProperties(XMLNode node);
-	bool processTileSet(XMLNode node);
-	bool processTileType(XMLNode node, TileType& type,
-			TiledImageRef& img, int id);
-	bool processLayer(XMLNode node);
-	bool processLayerProperties(XMLNode node, double* depth);
-	bool processLayerData(XMLNode node, int z);
-	bool processObjectGroup(XMLNode node);
-	bool processObjectGroupProperties(XMLNode node, double* depth);
-	bool processObject(XMLNode node, int z);
-	bool splitTileFlags(const std::string& strOfFlags, unsigned* flags);
-	bool parseExit(const std::string& dest, Exit* exit,
-		bool* wwide, bool* hwide);
-	bool parseRGBA(const std::string& str,
-		Gosu::Color::Channel* r,
-		Gosu::Color::Channel* g,
-		Gosu::Color::Channel* b,
-		Gosu::Color::Channel* a);
-
-	std::vector<TileType*> gids;
 };
 
 #endif
@@ -25,6 +25,7 @@
 // **********
 
 #include <algorithm>
+#include <functional>
 #include <math.h>
 #include <stdlib.h> // for exit(1) on fatal
 
@@ -33,35 +34,42 @@
 #include <Gosu/Timing.hpp>
 
 #include "area.h"
+#include "canvas.h"
 #include "client-conf.h"
 #include "entity.h"
 #include "formatter.h"
 #include "log.h"
 #include "image.h"
+#include "jobs.h"
 #include "music.h"
 #include "npc.h"
 #include "overlay.h"
+#include "particles.h"
 #include "python.h"
 #include "python-bindings-template.cpp"
 #include "reader.h"
+#include "renderer.h"
 #include "tile.h"
 #include "window.h"
 #include "world.h"
 
 #define ASSERT(x)  if (!(x)) { return false; }
 
+// Fewer chunks than this aren't worth handing to another thread.
+#define CHUNK_BAKES_PER_JOB 4
+
 /* NOTE: In the TMX map format used by Tiled, tileset tiles start counting
          their Y-positions from 0, while layer tiles start counting from 1. I
          can't imagine why the author did this, but we have to take it into
          account.
 */
 
+//! Bring value into [0, max), counting backwards from max if negative.
 template<class T>
-static T wrap(T min, T value, T max)
+static T wrap(T value, T max)
 {
-	while (value < min)
-		value += max;
-	return value % max;
+	T r = value % max;
+	return r < 0 ? r + max : r;
 }
 
 Area::Area(Viewport* view,
@@ -72,15 +80,27 @@ Area::Area(Viewport* view,
 	  colorOverlay(0, 0, 0, 0),
 	  dim(0, 0, 0),
 	  tileDim(0, 0),
+	  sheetsPinned(false),
 	  loopX(false), loopY(false),
 	  beenFocused(false),
 	  redraw(true),
+	  fullRedraw(true),
+	  partial(false),
+	  nextRedraw(ANIM_NEVER),
+	  chunkWidth(TILE_CHUNK_WIDTH),
+	  chunksPerRow(0),
+	  lastChunkSweep(0),
+	  prepareChunks(NULL),
+	  drawChunks(NULL),
 	  descriptor(descriptor)
 {
 }
 
 Area::~Area()
 {
+	// Scripts may still hold some.
+	for (EmitterList::iterator it = emitters.begin(); it != emitters.end(); it++)
+		(*it)->detach();
 }
 
 bool Area::init()
@@ -96,6 +116,12 @@ void Area::focus()
 		runLoadScripts();
 	}
 
+	if (!sheetsPinned) {
+		for (size_t i = 0; i < tileSheets.size(); i++)
+			tileSheets[i]->pin();
+		sheetsPinned = true;
+	}
+
 	if (musicIntroSet)
 		World::instance()->getMusic()->setIntro(musicIntro);
 	if (musicLoopSet)
@@ -106,6 +132,15 @@ void Area::focus()
 		focusScript->invoke();
 }
 
+void Area::unfocus()
+{
+	if (sheetsPinned) {
+		for (size_t i = 0; i < tileSheets.size(); i++)
+			tileSheets[i]->unpin();
+		sheetsPinned = false;
+	}
+}
+
 void Area::buttonDown(const Gosu::Button btn)
 {
 	if (btn == Gosu::kbRight)
@@ -134,47 +169,125 @@ void Area::buttonUp(const Gosu::Button btn)
 
 void Area::draw()
 {
-	drawTiles();
+	Renderer& renderer = Renderer::instance();
+	nextRedraw = ANIM_NEVER;
+
+	// Find everything that looks different from the last frame before
+	// drawing any of it. If the renderer kept that frame, only those
+	// parts are drawn again.
+	const icube tiles = visibleTiles();
+	prepareTiles(tiles);
+	findEntityDamage();
+	partial = !fullRedraw && renderer.setDamage(damaged);
+
+	drawTiles(tiles);
+	// Entities stand on the same depth as the tile row they occupy.
+	renderer.barrier();
 	drawEntities();
 	drawColorOverlay();
+
 	redraw = false;
+	fullRedraw = false;
+	partial = false;
+	damaged.clear();
 }
 
 bool Area::needsRedraw() const
 {
-	if (redraw)
-		return true;
-	if (player->needsRedraw())
-		return true;
+	return redraw || World::instance()->time() >= nextRedraw;
+}
 
-	for (CharacterSet::iterator it = characters.begin(); it != characters.end(); it++) {
-		Character* c = *it;
-		if (c->needsRedraw())
-			return true;
-	}
-	for (OverlaySet::iterator it = overlays.begin(); it != overlays.end(); it++) {
-		Overlay* o = *it;
-		if (o->needsRedraw())
-			return true;
+time_t Area::nextChange() const
+{
+	time_t now = World::instance()->time();
+
+	if (redraw || tickScript)
+		return now;
+	for (OverlaySet::const_iterator it = overlays.begin(); it != overlays.end(); it++)
+		if (!(*it)->isIdle())
+			return now;
+	for (EmitterList::const_iterator it = emitters.begin(); it != emitters.end(); it++)
+		if (!(*it)->isIdle())
+			return now;
+	// Mirrors tick(), which leaves Characters alone in TURN mode.
+	if (conf.moveMode != TURN) {
+		if (!player->isIdle())
+			return now;
+		for (CharacterSet::const_iterator it = characters.begin(); it != characters.end(); it++)
+			if (!(*it)->isIdle())
+				return now;
 	}
+	if (!World::instance()->getMusic()->isIdle())
+		return now;
 
-	// Do any on-screen tile types need to update their animations?
-	const icube tiles = visibleTiles();
-	for (int z = tiles.z1; z < tiles.z2; z++) {
-		for (int y = tiles.y1; y < tiles.y2; y++) {
-			for (int x = tiles.x1; x < tiles.x2; x++) {
-				const Tile* tile = getTile(x, y, z);
-				const TileType* type = tile->getType();
-				if (type && type->needsRedraw())
-					return true;
-			}
+	// Otherwise only animations move on, and draw() found the first.
+	return nextRedraw;
+}
+
+void Area::requestRedraw()
+{
+	redraw = true;
+}
+
+void Area::requestFullRedraw()
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+		chunks[i].dirty = true;
+	redraw = true;
+	fullRedraw = true;
+}
+
+void Area::damage(double x1, double y1, double x2, double y2)
+{
+	redraw = true;
+	if (fullRedraw)
+		return;
+
+	// Tiles are visited left to right, so neighbors on a row can usually
+	// share one rectangle.
+	if (damaged.size()) {
+		DamageRect& last = damaged.back();
+		if (last.y1 == y1 && last.y2 == y2 &&
+		    last.x1 <= x1 && x1 <= last.x2) {
+			last.x2 = std::max(last.x2, x2);
+			return;
 		}
 	}
+	if (damaged.size() == MAX_DAMAGE_RECTS) {
+		fullRedraw = true;
+		damaged.clear();
+		return;
+	}
+	DamageRect r = { x1, y1, x2, y2 };
+	damaged.push_back(r);
+}
+
+bool Area::isDamaged(double x1, double y1, double x2, double y2) const
+{
+	if (!partial)
+		return true;
+	for (size_t i = 0; i < damaged.size(); i++) {
+		const DamageRect& r = damaged[i];
+		if (x1 < r.x2 && r.x1 < x2 && y1 < r.y2 && r.y1 < y2)
+			return true;
+	}
 	return false;
 }
 
-void Area::requestRedraw()
+void Area::tileChanged(const Tile& tile)
 {
+	if (chunks.size()) {
+		int start;
+		int& occluder = occluders[(size_t)(tile.y * dim.x + tile.x)];
+		int top = findOccluder(tile.x, tile.y);
+		if (top != occluder) {
+			// Layers beneath now show more or less than before.
+			for (int z = 0; z < std::max(top, occluder); z++)
+				chunkAt(tile.x, tile.y, z, &start).dirty = true;
+			occluder = top;
+		}
+		chunkAt(tile.x, tile.y, tile.z, &start).dirty = true;
+	}
 	redraw = true;
 }
 
@@ -190,6 +303,14 @@ void Area::tick(unsigned long dt)
 		o->tick(dt);
 	}
 
+	for (EmitterList::iterator it = emitters.begin(); it != emitters.end(); it++) {
+		ParticleEmitter* e = it->get();
+		if (!e->isIdle()) {
+			e->tick(dt);
+			requestRedraw();
+		}
+	}
+
 	if (conf.moveMode != TURN) {
 		pythonSetGlobal("Area", this);
 		player->tick(dt);
@@ -238,6 +359,7 @@ void Area::setColorOverlay(int r, int g, int b, int a)
 		Color::Channel bc = (Color::Channel)b;
 		colorOverlay = Color(ac, rc, gc, bc);
 		redraw = true;
+		fullRedraw = true;
 	}
 	else {
 		PyErr_Format(PyExc_ValueError,
@@ -251,9 +373,9 @@ void Area::setColorOverlay(int r, int g, int b, int a)
 const Tile* Area::getTile(int x, int y, int z) const
 {
 	if (loopX)
-		x = wrap(0, x, dim.x);
+		x = wrap(x, dim.x);
 	if (loopY)
-		y = wrap(0, y, dim.y);
+		y = wrap(y, dim.y);
 	if (inBounds(x, y, z))
 		return &map[z][y][x];
 	else
@@ -283,9 +405,9 @@ const Tile* Area::getTile(rcoord virt) const
 Tile* Area::getTile(int x, int y, int z)
 {
 	if (loopX)
-		x = wrap(0, x, dim.x);
+		x = wrap(x, dim.x);
 	if (loopY)
-		y = wrap(0, y, dim.y);
+		y = wrap(y, dim.y);
 	if (inBounds(x, y, z))
 		return &map[z][y][x];
 	else
@@ -366,6 +488,32 @@ icube Area::visibleTiles() const
 	return cube;
 }
 
+/**
+ * Find the multiple of period that brings the span [pos, pos+size) over
+ * [lo, hi), trying only 0 unless loop is set.
+ */
+static bool spanOnScreen(double pos, double size, double lo, double hi,
+                         bool loop, double period, double* shift)
+{
+	*shift = 0.0;
+	if (loop) {
+		// The leftmost copy that ends past lo.
+		*shift = (floor((lo - pos - size) / period) + 1.0) * period;
+	}
+	return pos + *shift + size > lo && pos + *shift < hi;
+}
+
+bool Area::onScreen(rvec2 pos, ivec2 size, rvec2* shift) const
+{
+	rvec2 off = view->getMapOffset();
+	rvec2 screen = view->getVirtRes();
+
+	return spanOnScreen(pos.x, size.x, off.x, off.x + screen.x,
+	                    loopX, dim.x * tileDim.x, &shift->x) &&
+	       spanOnScreen(pos.y, size.y, off.y, off.y + screen.y,
+	                    loopY, dim.y * tileDim.y, &shift->y);
+}
+
 bool Area::inBounds(int x, int y, int z) const
 {
 	return ((loopX || (0 <= x && x < dim.x)) &&
@@ -457,6 +605,30 @@ Entity* Area::spawnOverlay(const std::string& descriptor,
 	return o;
 }
 
+ParticleEmitterRef Area::spawnEmitter(const std::string& imagePath)
+{
+	ImageRef img = Reader::getImage(imagePath);
+	if (!img) {
+		// Error logged.
+		return ParticleEmitterRef();
+	}
+	ParticleEmitterRef e(new ParticleEmitter(this, view, img));
+	emitters.push_back(e);
+	return e;
+}
+
+void Area::removeEmitter(ParticleEmitterRef e)
+{
+	EmitterList::iterator it = std::find(emitters.begin(), emitters.end(), e);
+	if (it == emitters.end()) {
+		Log::err(descriptor, "remove_emitter: emitter not in this Area");
+		return;
+	}
+	e->undraw();
+	e->detach();
+	emitters.erase(it);
+}
+
 void Area::insert(Character* c)
 {
 	characters.insert(c);
@@ -469,11 +641,13 @@ void Area::insert(Overlay* o)
 
 void Area::erase(Character* c)
 {
+	c->undraw();
 	characters.erase(c);
 }
 
 void Area::erase(Overlay* o)
 {
+	o->undraw();
 	overlays.erase(o);
 }
 
@@ -545,6 +719,20 @@ double Area::indexDepth(int idx) const
 
 
 
+void Area::allocateMapLayer()
+{
+	map.push_back(grid_t(dim.y, row_t(dim.x)));
+	grid_t& grid = map[dim.z];
+	for (int y = 0; y < dim.y; y++) {
+		row_t& row = grid[y];
+		for (int x = 0; x < dim.x; x++) {
+			Tile& tile = row[x];
+			new (&tile) Tile(this, x, y, dim.z);
+		}
+	}
+	dim.z++;
+}
+
 void Area::runLoadScripts()
 {
 	World* world = World::instance();
@@ -555,16 +743,110 @@ void Area::runLoadScripts()
 		loadScript->invoke();
 }
 
-void Area::drawTiles()
+/*
+ * Work order for filling one Canvas off the main thread. See bakeChunks().
+ */
+struct CanvasJob
+{
+	struct Blit {
+		const Image* img;
+		unsigned x;
+	};
+
+	std::unique_ptr<Canvas> canvas;
+	std::vector<Blit> blits;
+};
+
+static void fillCanvas(std::vector<CanvasJob>* jobs, size_t i)
+{
+	CanvasJob& job = (*jobs)[i];
+	for (size_t b = 0; b < job.blits.size(); b++)
+		job.canvas->blit(*job.blits[b].img, job.blits[b].x, 0);
+}
+
+void Area::prepareTiles(const icube& tiles)
+{
+	if (chunks.empty()) {
+		allocateChunks();
+		initTileClock();
+		initOcclusion();
+	}
+	tileClock.tick(World::instance()->time());
+	(this->*prepareChunks)(tiles);
+}
+
+void Area::drawTiles(const icube& tiles)
+{
+	time_t now = GameWindow::instance().time();
+	(this->*drawChunks)(tiles, now);
+
+	if (now > lastChunkSweep + TILE_CHUNK_TTL &&
+	    GameWindow::instance().hasHeadroom()) {
+		lastChunkSweep = now;
+		sweepChunks(now);
+	}
+}
+
+template<bool LoopX, bool LoopY>
+void Area::prepareChunksIn(const icube& tiles)
+{
+	// Looping Areas look up where each visible row and column wraps to
+	// once per draw. Otherwise, coordinates are already in bounds.
+	if (LoopX) {
+		wrappedCols.resize((size_t)(tiles.x2 - tiles.x1));
+		for (int x = tiles.x1; x < tiles.x2; x++)
+			wrappedCols[(size_t)(x - tiles.x1)] = wrap(x, dim.x);
+	}
+	if (LoopY) {
+		wrappedRows.resize((size_t)(tiles.y2 - tiles.y1));
+		for (int y = tiles.y1; y < tiles.y2; y++)
+			wrappedRows[(size_t)(y - tiles.y1)] = wrap(y, dim.y);
+	}
+
+	std::vector<TileChunk*> dirty;
+	for (int z = tiles.z1; z < tiles.z2; z++) {
+		for (int y = tiles.y1; y < tiles.y2; y++) {
+			int wy = LoopY ? wrappedRows[(size_t)(y - tiles.y1)] : y;
+			TileChunk* row = &chunks[(size_t)((z * dim.y + wy) *
+			                                  chunksPerRow)];
+			for (int x = tiles.x1; x < tiles.x2; ) {
+				int wx = LoopX ?
+					wrappedCols[(size_t)(x - tiles.x1)] : x;
+				TileChunk& chunk = row[wx / chunkWidth];
+				int start = x - (wx - chunk.x);
+				if (chunk.dirty) {
+					dirty.push_back(&chunk);
+					damage(start * tileDim.x, y * tileDim.y,
+					       (start + chunk.width) * tileDim.x,
+					       (y + 1) * tileDim.y);
+				}
+				else
+					findTileDamage(chunk, start, y, tiles);
+				x = start + chunk.width;
+			}
+		}
+	}
+	if (dirty.size())
+		bakeChunks(dirty);
+}
+
+template<bool LoopX, bool LoopY>
+void Area::drawChunksIn(const icube& tiles, time_t now)
 {
-	icube tiles = visibleTiles();
 	for (int z = tiles.z1; z < tiles.z2; z++) {
-		double depth = idx2depth[z];
+		double depth = idx2depth[(size_t)z];
 		for (int y = tiles.y1; y < tiles.y2; y++) {
-			for (int x = tiles.x1; x < tiles.x2; x++) {
-				Tile* tile = getTile(x, y, z);
-				// We are certain the Tile exists.
-				drawTile(*tile, x, y, depth);
+			int wy = LoopY ? wrappedRows[(size_t)(y - tiles.y1)] : y;
+			TileChunk* row = &chunks[(size_t)((z * dim.y + wy) *
+			                                  chunksPerRow)];
+			for (int x = tiles.x1; x < tiles.x2; ) {
+				int wx = LoopX ?
+					wrappedCols[(size_t)(x - tiles.x1)] : x;
+				TileChunk& chunk = row[wx / chunkWidth];
+				int start = x - (wx - chunk.x);
+				chunk.lastDrawn = now;
+				drawChunk(chunk, start, y, depth, tiles);
+				x = start + chunk.width;
 			}
 		}
 	}
@@ -574,30 +856,258 @@ void Area::drawTile(Tile& tile, int x, int y, double depth)
 {
 	TileType* type = (TileType*)tile.parent;
 	if (type) {
-		time_t now = World::instance()->time();
-		const Image* img = type->anim.frame(now);
-		if (img) {
+		const Image* img;
+		if (type->animSlot >= 0) {
+			size_t slot = (size_t)type->animSlot;
+			img = tileClock.frame(slot);
+			redrawAt(tileClock.nextFrameTime(slot));
+		}
+		else {
+			time_t now = World::instance()->time();
+			img = type->anim.frame(now);
+		}
+		if (img && img->opacity() != IMAGE_TRANSPARENT) {
 			rvec2 drawPos(
 				double(x * (int)img->width()),
 				double(y * (int)img->height())
 			);
-			img->draw(drawPos.x, drawPos.y,
-			          depth + isometricZOff(drawPos));
+			if (isDamaged(drawPos.x, drawPos.y,
+			              drawPos.x + img->width(),
+			              drawPos.y + img->height()))
+				img->draw(drawPos.x, drawPos.y,
+				          depth + isometricZOff(drawPos));
 		}
 	}
 }
 
+void Area::findTileDamage(const TileChunk& chunk, int start, int y,
+                          const icube& tiles)
+{
+	const row_t& row = map[chunk.z][chunk.y];
+	for (size_t i = 0; i < chunk.animated.size(); i++) {
+		int off = chunk.animated[i];
+		int x = start + off;
+		TileType* type = row[chunk.x + off].getType();
+		if (tiles.x1 <= x && x < tiles.x2 && type->animSlot >= 0 &&
+		    tileClock.changed((size_t)type->animSlot))
+			damage(x * tileDim.x, y * tileDim.y,
+			       (x + 1) * tileDim.x, (y + 1) * tileDim.y);
+	}
+}
+
+void Area::initTileClock()
+{
+	tileClock.clear();
+	for (tilesets_t::iterator it = tileSets.begin(); it != tileSets.end(); it++) {
+		TileSet& set = it->second;
+		for (size_t i = 0; i < set.size(); i++) {
+			TileType* type = set.at(i);
+			if (type && type->anim.isAnimated())
+				type->animSlot = (int)tileClock.add(&type->anim);
+		}
+	}
+}
+
+void Area::initOcclusion()
+{
+	occluders.resize((size_t)(dim.x * dim.y));
+	for (int y = 0; y < dim.y; y++)
+		for (int x = 0; x < dim.x; x++)
+			occluders[(size_t)(y * dim.x + x)] = findOccluder(x, y);
+}
+
+int Area::findOccluder(int x, int y) const
+{
+	for (int z = dim.z - 1; z >= 0; z--) {
+		const TileType* type = map[z][y][x].getType();
+		if (type && type->anim.opacity() == IMAGE_OPAQUE)
+			return z;
+	}
+	return -1;
+}
+
+bool Area::isOccluded(int x, int y, int z) const
+{
+	return z < occluders[(size_t)(y * dim.x + x)];
+}
+
+Area::TileChunk::TileChunk()
+	: x(0), y(0), z(0), width(0), dirty(true), lastDrawn(0)
+{
+}
+
+void Area::allocateChunks()
+{
+	// An Area's loop mode is fixed once it has loaded.
+	if (loopX && loopY) {
+		prepareChunks = &Area::prepareChunksIn<true, true>;
+		drawChunks = &Area::drawChunksIn<true, true>;
+	}
+	else if (loopX) {
+		prepareChunks = &Area::prepareChunksIn<true, false>;
+		drawChunks = &Area::drawChunksIn<true, false>;
+	}
+	else if (loopY) {
+		prepareChunks = &Area::prepareChunksIn<false, true>;
+		drawChunks = &Area::drawChunksIn<false, true>;
+	}
+	else {
+		prepareChunks = &Area::prepareChunksIn<false, false>;
+		drawChunks = &Area::drawChunksIn<false, false>;
+	}
+
+	chunkWidth = std::max(1, std::min(TILE_CHUNK_WIDTH,
+		TILE_CHUNK_MAX_PIXELS / std::max(1, tileDim.x)));
+	chunksPerRow = (dim.x + chunkWidth - 1) / chunkWidth;
+	chunks.resize((size_t)(chunksPerRow * dim.y * dim.z));
+
+	size_t i = 0;
+	for (int z = 0; z < dim.z; z++) {
+		for (int y = 0; y < dim.y; y++) {
+			for (int x = 0; x < dim.x; x += chunkWidth) {
+				TileChunk& chunk = chunks[i++];
+				chunk.x = x;
+				chunk.y = y;
+				chunk.z = z;
+				chunk.width = std::min(chunkWidth, dim.x - x);
+			}
+		}
+	}
+}
+
+Area::TileChunk& Area::chunkAt(int x, int y, int z, int* start)
+{
+	int wx = loopX ? wrap(x, dim.x) : x;
+	int wy = loopY ? wrap(y, dim.y) : y;
+	*start = x - wx % chunkWidth;
+	size_t idx = (size_t)((z * dim.y + wy) * chunksPerRow +
+	                      wx / chunkWidth);
+	return chunks[idx];
+}
+
+void Area::bakeChunks(const std::vector<TileChunk*>& dirty)
+{
+	time_t now = World::instance()->time();
+	std::vector<CanvasJob> jobs;
+	std::vector<TileChunk*> baking;
+
+	// Sort the strip's Tiles into static and animated on this thread.
+	// Only the pixel copying is safe to hand off to other threads.
+	for (size_t i = 0; i < dirty.size(); i++) {
+		TileChunk& chunk = *dirty[i];
+		chunk.dirty = false;
+		chunk.img.reset();
+		chunk.animated.clear();
+
+		CanvasJob job;
+		row_t& row = map[chunk.z][chunk.y];
+		for (int off = 0; off < chunk.width; off++) {
+			TileType* type = row[chunk.x + off].getType();
+			if (!type ||
+			    type->anim.opacity() == IMAGE_TRANSPARENT ||
+			    isOccluded(chunk.x + off, chunk.y, chunk.z))
+				continue;
+			if (type->anim.isAnimated()) {
+				chunk.animated.push_back(off);
+				continue;
+			}
+			const Image* img = type->anim.frame(now);
+			if (img) {
+				CanvasJob::Blit blit = {
+					img, (unsigned)(off * tileDim.x)
+				};
+				job.blits.push_back(blit);
+			}
+		}
+		if (job.blits.empty())
+			continue;
+
+		job.canvas.reset(Canvas::create(
+			(unsigned)(chunk.width * tileDim.x),
+			(unsigned)tileDim.y));
+		jobs.push_back(std::move(job));
+		baking.push_back(&chunk);
+	}
+
+	Jobs::parallelFor("bake chunks", jobs.size(), CHUNK_BAKES_PER_JOB,
+		std::bind(fillCanvas, &jobs, std::placeholders::_1));
+
+	// Uploading to the graphics card has to happen on the main thread.
+	for (size_t i = 0; i < jobs.size(); i++)
+		baking[i]->img.reset(jobs[i].canvas->toImage());
+}
+
+void Area::drawChunk(TileChunk& chunk, int start, int y, double depth,
+                     const icube& tiles)
+{
+	if (chunk.img) {
+		rvec2 drawPos(
+			double(start * tileDim.x),
+			double(y * tileDim.y)
+		);
+		if (isDamaged(drawPos.x, drawPos.y,
+		              drawPos.x + chunk.width * tileDim.x,
+		              drawPos.y + tileDim.y))
+			chunk.img->draw(drawPos.x, drawPos.y,
+			                depth + isometricZOff(drawPos));
+	}
+
+	row_t& row = map[chunk.z][chunk.y];
+	for (size_t i = 0; i < chunk.animated.size(); i++) {
+		int off = chunk.animated[i];
+		int x = start + off;
+		if (tiles.x1 <= x && x < tiles.x2)
+			drawTile(row[chunk.x + off], x, y, depth);
+	}
+}
+
+void Area::sweepChunks(time_t now)
+{
+	for (size_t i = 0; i < chunks.size(); i++) {
+		TileChunk& chunk = chunks[i];
+		if (chunk.img && now > chunk.lastDrawn + TILE_CHUNK_TTL) {
+			chunk.img.reset();
+			chunk.dirty = true;
+		}
+	}
+}
+
+void Area::findEntityDamage()
+{
+	for (CharacterSet::iterator it = characters.begin(); it != characters.end(); it++)
+		(*it)->findDamage();
+	for (OverlaySet::iterator it = overlays.begin(); it != overlays.end(); it++)
+		(*it)->findDamage();
+	for (EmitterList::iterator it = emitters.begin(); it != emitters.end(); it++)
+		(*it)->findDamage();
+	player->findDamage();
+}
+
 void Area::drawEntities()
 {
+	// Off-screen entities are skipped and their animations don't
+	// schedule redraws.
 	for (CharacterSet::iterator it = characters.begin(); it != characters.end(); it++) {
 		Character* c = *it;
-		c->draw();
+		if (c->draw())
+			redrawAt(c->nextFrameTime());
 	}
 	for (OverlaySet::iterator it = overlays.begin(); it != overlays.end(); it++) {
 		Overlay* o = *it;
-		o->draw();
+		if (o->draw())
+			redrawAt(o->nextFrameTime());
 	}
-	player->draw();
+	Renderer::instance().barrier();
+	if (player->draw())
+		redrawAt(player->nextFrameTime());
+	for (EmitterList::iterator it = emitters.begin(); it != emitters.end(); it++)
+		(*it)->draw();
+}
+
+void Area::redrawAt(time_t deadline)
+{
+	if (deadline < nextRedraw)
+		nextRedraw = deadline;
 }
 
 void Area::drawColorOverlay()
@@ -607,13 +1117,7 @@ void Area::drawColorOverlay()
 		Gosu::Color c = colorOverlay;
 		int x = window.width();
 		int y = window.height();
-		window.graphics().drawQuad(
-			0, 0, c,
-			x, 0, c,
-			x, y, c,
-			0, y, c,
-			750
-		);
+		window.drawRect(0, x, 0, y, c, 750);
 	}
 }
 
@@ -635,7 +1139,7 @@ void exportArea()
 	class_<Area>("Area", no_init)
 		.add_property("descriptor", &Area::getDescriptor)
 //		.add_property("dimensions", &Area::pyGetDimensions)
-		.def("redraw", &Area::requestRedraw)
+		.def("redraw", &Area::requestFullRedraw)
 		.def("tileset", &Area::getTileSet,
 		    return_value_policy<reference_existing_object>())
 		.def("tile",
@@ -650,6 +1154,8 @@ void exportArea()
 		    return_value_policy<reference_existing_object>())
 		.def("new_overlay", &Area::spawnOverlay,
 		    return_value_policy<reference_existing_object>())
+		.def("new_emitter", &Area::spawnEmitter)
+		.def("remove_emitter", &Area::removeEmitter)
 //		.def_readwrite("on_focus", &Area::focusScript)
 //		.def_readwrite("on_tick", &Area::tickScript)
 //		.def_readwrite("on_turn", &Area::turnScript)
@@ -35,13 +35,34 @@
 // #include <boost/python/tuple.hpp>
 #include <Gosu/Color.hpp>
 
+#include "animation.h"
 #include "entity.h"
+#include "particles.h"
+#include "renderer.h"
 #include "script.h"
 #include "tile.h"
 #include "vec.h"
 
 #define ISOMETRIC_ZOFF_PER_TILE 0.001
 
+//! Width in Tiles of the strips that static tile layers are pre-rendered
+//! into. See Area::drawTiles().
+#define TILE_CHUNK_WIDTH 16
+
+//! Widest a strip can be in pixels. Gosu splits wider images over several
+//! textures, which the renderer can't batch: 1024 pixel textures, less a
+//! pixel of border on either side. Areas with large Tiles use narrower
+//! strips.
+#define TILE_CHUNK_MAX_PIXELS 1022
+
+//! Milliseconds a pre-rendered strip can go without being drawn before we
+//! free its image.
+#define TILE_CHUNK_TTL (10 * 1000)
+
+//! Most separate parts of the screen a frame will redraw. Past this, the
+//! whole screen is.
+#define MAX_DAMAGE_RECTS 32
+
 namespace Gosu {
 	class Bitmap;
 	class Button;
@@ -77,6 +98,9 @@ public:
 	//! Prepare game state for this Area to be in focus.
 	void focus();
 
+	//! Another Area took focus. Our tilesets' textures may be evicted.
+	void unfocus();
+
 	//! Processes keyboard input, calling the Player object when necessary.
 	void buttonDown(const Gosu::Button btn);
 	void buttonUp(const Gosu::Button btn);
@@ -87,9 +111,28 @@ public:
 	//! If false, drawing might be skipped. Saves CPU cycles when idle.
 	bool needsRedraw() const;
 
+	//! World time at which tick() or draw() could next change something
+	//! without any input arriving. The current time if they already are.
+	time_t nextChange() const;
+
 	//! Inform the Area that a redraw is needed.
 	void requestRedraw();
 
+	//! Throw away pre-rendered tile layers and redraw everything. Called
+	//! when scripts ask for a redraw.
+	void requestFullRedraw();
+
+	//! Inform the Area that a Tile's type has changed.
+	void tileChanged(const Tile& tile);
+
+	//! The rectangle between (x1, y1) and (x2, y2), in Area pixels, looks
+	//! different now and has to be drawn again.
+	void damage(double x1, double y1, double x2, double y2);
+
+	//! Does anything in this rectangle need drawing this frame? Always
+	//! true unless the frame redraws only damaged parts of the screen.
+	bool isDamaged(double x1, double y1, double x2, double y2) const;
+
 	/**
 	 * Update the game state within this Area as if dt milliseconds had
 	 * passed since the last call. Updates Entities, runs scripts, and
@@ -130,6 +173,11 @@ public:
 	//! Returns a physical cubic range of Tiles that are visible on-screen.
 	//! Takes actual map size into account.
 	icube visibleTiles() const;
+	//! Would a sprite with its upper-left corner at pos be on-screen? In
+	//! directions the Area loops in, the sprite is also looked for a
+	//! whole number of Area lengths away, and shift is set to the
+	//! distance at which it was found.
+	bool onScreen(rvec2 pos, ivec2 size, rvec2* shift) const;
 
 	//! Returns true if a Tile exists at the specified coordinate.
 	bool inBounds(int x, int y, int z) const; /* phys */
@@ -148,6 +196,12 @@ public:
 		int x, int y, double z, const std::string& phase);
 	Entity* spawnOverlay(const std::string& descriptor,
 		int x, int y, double z, const std::string& phase);
+	//! Add a ParticleEmitter drawing the given image. It lives until
+	//! removeEmitter() or until the Area is destroyed.
+	ParticleEmitterRef spawnEmitter(const std::string& imagePath);
+	//! Take away a ParticleEmitter made by spawnEmitter(). Scripts may
+	//! keep it, but it is no longer ticked or drawn.
+	void removeEmitter(ParticleEmitterRef e);
 	void insert(Character* c);
 	void insert(Overlay* o);
 	void erase(Character* c);
@@ -182,12 +236,69 @@ protected:
 	int depthIndex(double depth) const;
 	double indexDepth(int idx) const;
 
+	//! Allocate Tile objects for one layer of map.
+	void allocateMapLayer();
+
 	//! Run scripts that needs to be run before this Area is usable.
 	void runLoadScripts();
 
+	//! A horizontal strip of up to chunkWidth Tiles on one layer.
+	//! The static Tiles in the strip are baked into a single image so
+	//! they can be drawn with one call. Animated Tiles are still drawn
+	//! individually.
+	struct TileChunk
+	{
+		TileChunk();
+
+		int x, y, z;  //!< Physical coordinates of the leftmost Tile.
+		int width;    //!< Number of Tiles in the strip.
+		bool dirty;   //!< Needs to be baked again before drawing.
+		time_t lastDrawn;
+		ImageRef img; //!< NULL if there are no static Tiles.
+		std::vector<int> animated; //!< X offsets of animated Tiles.
+	};
+
+	//! Bake pre-rendered strips and find damaged Tiles.
+	void prepareTiles(const icube& tiles);
 	//! Calculate frame to show for each type of tile
-	void drawTiles();
+	void drawTiles(const icube& tiles);
 	void drawTile(Tile& tile, int x, int y, double depth);
+	//! Damage animated Tiles in a strip that changed frames.
+	void findTileDamage(const TileChunk& chunk, int start, int y,
+	                    const icube& tiles);
+
+	//! Put every animated TileType on tileClock.
+	void initTileClock();
+
+	//! Fill occluders for every column of Tiles.
+	void initOcclusion();
+	//! The highest layer at (x, y) whose Tile hides everything beneath
+	//! it, or -1.
+	int findOccluder(int x, int y) const;
+	//! Is the Tile at physical (x, y, z) covered by an opaque one?
+	bool isOccluded(int x, int y, int z) const;
+
+	//! Make sure we draw again no later than the given World time.
+	void redrawAt(time_t deadline);
+
+	void allocateChunks();
+	//! Bake, then draw, the chunks covering tiles. Instantiated once for
+	//! each loop mode so that Areas pay only for the wrapping they use.
+	template<bool LoopX, bool LoopY>
+	void prepareChunksIn(const icube& tiles);
+	template<bool LoopX, bool LoopY>
+	void drawChunksIn(const icube& tiles, time_t now);
+	//! Find the chunk holding the Tile at (x, y, z). x and y may lie
+	//! outside the Area if it loops. start is set to the x of the chunk's
+	//! leftmost Tile, unwrapped into the same space as x.
+	TileChunk& chunkAt(int x, int y, int z, int* start);
+	void bakeChunks(const std::vector<TileChunk*>& dirty);
+	void drawChunk(TileChunk& chunk, int start, int y, double depth,
+	               const icube& tiles);
+	//! Free images of chunks that haven't been on-screen in a while.
+	void sweepChunks(time_t now);
+
+	void findEntityDamage();
 	void drawEntities();
 	void drawColorOverlay();
 
@@ -200,6 +311,8 @@ protected:
 	CharacterSet characters;
 	typedef std::set<Overlay*> OverlaySet;
 	OverlaySet overlays;
+	typedef std::vector<ParticleEmitterRef> EmitterList;
+	EmitterList emitters;
 
 	typedef std::vector<Tile> row_t;
 	typedef std::vector<row_t> grid_t;
@@ -218,6 +331,10 @@ protected:
 	typedef std::map<std::string, TileSet> tilesets_t;
 	tilesets_t tileSets;
 
+	//! Images of our tilesets. Pinned while we are focused.
+	std::vector<TiledImageRef> tileSheets;
+	bool sheetsPinned;
+
 	//! Maps virtual float-point depths to an index in our map array.
 	std::map<double, int> depth2idx;
 
@@ -230,6 +347,42 @@ protected:
 	bool beenFocused;
 	bool redraw;
 
+	//! Everything on-screen has to be drawn again, not just what's in
+	//! damaged.
+	bool fullRedraw;
+	//! Only damaged parts of the screen are being drawn.
+	bool partial;
+	//! Parts of the screen, in Area pixels, that changed since the last
+	//! draw.
+	std::vector<DamageRect> damaged;
+
+	//! World time at which something on-screen will next change on its
+	//! own, such as a tile or Entity animation switching frames.
+	//! Recalculated on every draw.
+	time_t nextRedraw;
+
+	//! Frames of all animated TileTypes, resolved once per draw.
+	AnimationClock tileClock;
+
+	//! Pre-rendered tile strips, indexed by [z][y][x / chunkWidth].
+	//! Allocated when first drawn.
+	std::vector<TileChunk> chunks;
+	int chunkWidth; //!< Tiles per strip.
+	int chunksPerRow;
+	time_t lastChunkSweep;
+
+	//! The kernels for our loop mode. Picked by allocateChunks().
+	void (Area::*prepareChunks)(const icube& tiles);
+	void (Area::*drawChunks)(const icube& tiles, time_t now);
+	//! Wrapped index of each visible column and row, relative to the
+	//! first. Only filled in directions the Area loops in.
+	std::vector<int> wrappedCols, wrappedRows;
+
+	//! Result of findOccluder() for each column, indexed by [y][x].
+	//! Tiles below a column's occluder are neither baked nor drawn.
+	//! Allocated along with the chunks.
+	std::vector<int> occluders;
+
 	// The following contain filenames such that they may be loaded lazily.
 	const std::string descriptor;
 	std::string musicIntro, musicLoop;
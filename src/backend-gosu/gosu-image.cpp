@@ -25,6 +25,7 @@
 // **********
 
 #include <cassert>
+#include <functional>
 
 #include <Gosu/Bitmap.hpp>
 #include <Gosu/Graphics.hpp>
@@ -32,13 +33,17 @@
 
 #include "gosu-cbuffer.h"
 #include "gosu-image.h"
-#include "../window.h"
+#include "gosu-renderer.h"
+#include "gosu-thread.h"
+#include "gosu-texture.h"
+#include "gosu-window.h"
+#include "../client-conf.h"
 
 
-Image* Image::create(void* data, size_t length)
+Image* Image::create(const std::string& name, void* data, size_t length)
 {
 	ImageImpl* ii = new ImageImpl;
-	if (ii->init(data, length))
+	if (ii->init(name, data, length))
 		return ii;
 	else {
 		delete ii;
@@ -46,73 +51,152 @@ Image* Image::create(void* data, size_t length)
 	}
 }
 
+// Textures can only be made on the thread that owns OpenGL.
+
+static void newImage(Gosu::Image** img, const Gosu::Bitmap* bitmap,
+                     bool tileable)
+{
+	Gosu::Graphics& graphics = GameWindowImpl::instance().graphics();
+	*img = new Gosu::Image(graphics, *bitmap, tileable);
+}
+
+static void newSubImage(Gosu::Image** img, const Gosu::Bitmap* bitmap,
+                        unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	Gosu::Graphics& graphics = GameWindowImpl::instance().graphics();
+	*img = new Gosu::Image(graphics, *bitmap, x, y, w, h, false);
+}
+
 
 ImageImpl::ImageImpl()
-	: img(NULL)
+	: img(NULL), w(0), h(0), srcX(0), srcY(0), coverage(IMAGE_MIXED)
 {
 }
 
 ImageImpl::~ImageImpl()
 {
-	delete img;
+	if (group)
+		group->remove(this);
+	if (img)
+		releaseOnGLThread(img);
 }
 
-bool ImageImpl::init(void* data, size_t length)
+bool ImageImpl::init(const std::string& name, void* data, size_t length)
 {
 	assert(img == NULL);
 
-	Gosu::Graphics& graphics = GameWindow::instance().graphics();
 	Gosu::CBuffer buffer(data, length);
-	Gosu::Bitmap bitmap;
+	BitmapRef bitmap(new Gosu::Bitmap);
+
+	Gosu::loadImageFile(*bitmap, buffer.frontReader());
 
-	Gosu::loadImageFile(bitmap, buffer.frontReader());
-	img = new Gosu::Image(graphics, bitmap, false);
+	// A group of one, so that sprites and overlays count against the
+	// video memory budget as tilesets do.
+	ResidencyGroupRef group(new ResidencyGroup(name, bitmap));
+	init(bitmap, group, 0, 0, bitmap->width(), bitmap->height());
+	group->queueUpload();
+	return true;
+}
+
+bool ImageImpl::init(const BitmapRef& bitmap,
+                     const ResidencyGroupRef& group,
+                     unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	assert(img == NULL);
 
+	source = bitmap;
+	srcX = x;
+	srcY = y;
+	this->w = w;
+	this->h = h;
+	this->group = group;
+	group->add(this);
 	return true;
 }
 
-bool ImageImpl::init(Gosu::Bitmap& bitmap, unsigned x, unsigned y,
-				unsigned w, unsigned h)
+bool ImageImpl::init(const Gosu::Bitmap& bitmap, bool tileable)
 {
 	assert(img == NULL);
 
-	Gosu::Graphics& graphics = GameWindow::instance().graphics();
-	img = new Gosu::Image(graphics, bitmap, x, y, w, h, false);
+	// Not kept in source: baked images are never baked again.
+	CompactTextureRef texture;
+	if (conf.compactTextures)
+		texture = CompactTexture::create(bitmap);
+	if (texture)
+		img = texture->subImage(0, 0, bitmap.width(), bitmap.height());
+	else
+		runOnGLThread(std::bind(newImage, &img, &bitmap, tileable));
+	w = bitmap.width();
+	h = bitmap.height();
 	return true;
 }
 
+void ImageImpl::upload(const CompactTextureRef& texture)
+{
+	assert(img == NULL && source);
+
+	if (texture)
+		img = texture->subImage(srcX, srcY, w, h);
+	else
+		runOnGLThread(std::bind(newSubImage, &img, source.get(),
+		                        srcX, srcY, w, h));
+}
+
+void ImageImpl::evict()
+{
+	if (img)
+		releaseOnGLThread(img);
+	img = NULL;
+}
+
 
 void ImageImpl::draw(double dstX, double dstY, double z) const
 {
+	if (group)
+		group->touch();
 	assert(img != NULL);
 
-	img->draw(dstX, dstY, z);
+	RendererImpl::instance().draw(*img, dstX, dstY, z);
 }
 
 void ImageImpl::drawSubrect(double dstX, double dstY, double z,
 		 double srcX, double srcY,
 		 double srcW, double srcH)
 {
+	if (group)
+		group->touch();
 	assert(img != NULL);
 
-	Gosu::Graphics& g = GameWindow::instance().graphics();
-	g.beginClipping(dstX + srcX, dstY + srcY, srcW, srcH);
-	draw(dstX, dstY, z);
-	g.endClipping();
+	RendererImpl::instance().drawClipped(*img, dstX, dstY, z,
+		dstX + srcX, dstY + srcY, srcW, srcH);
 }
 
 
 unsigned ImageImpl::width() const
 {
-	assert(img != NULL);
-
-	return img->width();
+	return w;
 }
 
 unsigned ImageImpl::height() const
 {
-	assert(img != NULL);
+	return h;
+}
+
+ImageOpacity ImageImpl::opacity() const
+{
+	return coverage;
+}
+
+void ImageImpl::setOpacity(ImageOpacity opacity)
+{
+	coverage = opacity;
+}
+
+void ImageImpl::copyTo(Gosu::Bitmap& dst, unsigned dstX, unsigned dstY) const
+{
+	assert(source);
 
-	return img->height();
+	dst.insert(*source, (int)dstX, (int)dstY,
+	           srcX, srcY, width(), height());
 }
 
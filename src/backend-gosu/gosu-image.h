@@ -27,20 +27,29 @@
 #ifndef GOSU_IMAGE_H
 #define GOSU_IMAGE_H
 
+#include <memory>
+
+#include "gosu-residency.h"
+#include "gosu-texture.h"
 #include "../image.h"
 
 namespace Gosu { class Bitmap; }
 namespace Gosu { class Image; }
 
+typedef std::shared_ptr<Gosu::Bitmap> BitmapRef;
+
 class ImageImpl : public Image
 {
 public:
 	ImageImpl();
 	~ImageImpl();
 
-	bool init(void* data, size_t length);
-	bool init(Gosu::Bitmap& bitmap, unsigned x, unsigned y,
-	                                unsigned w, unsigned h);
+	//! name is only used in logs.
+	bool init(const std::string& name, void* data, size_t length);
+	//! Part of bitmap. Nothing is uploaded until group is.
+	bool init(const BitmapRef& bitmap, const ResidencyGroupRef& group,
+	          unsigned x, unsigned y, unsigned w, unsigned h);
+	bool init(const Gosu::Bitmap& bitmap, bool tileable);
 
 	void draw(double dstX, double dstY, double z) const;
 	void drawSubrect(double dstX, double dstY, double z,
@@ -50,8 +59,34 @@ public:
 	unsigned width() const;
 	unsigned height() const;
 
+	ImageOpacity opacity() const;
+	void setOpacity(ImageOpacity opacity);
+
+	//! Copy our pixels into dst. Used by CanvasImpl. Thread-safe.
+	void copyTo(Gosu::Bitmap& dst, unsigned dstX, unsigned dstY) const;
+
+	//! Make our texture from source, or from texture if it isn't NULL.
+	//! Called by our ResidencyGroup.
+	void upload(const CompactTextureRef& texture);
+	//! Let go of our texture. Called by our ResidencyGroup.
+	void evict();
+
 private:
+	//! NULL while evicted.
 	Gosu::Image* img;
+	unsigned w, h;
+
+	//! Only baked images, which have no source, are without one. They
+	//! are uploaded for as long as they live.
+	ResidencyGroupRef group;
+
+	//! CPU-side copy of the pixels we were created from. Kept so that we
+	//! can be baked into a Canvas without reading back from the GPU.
+	//! May be shared with other images cut from the same bitmap.
+	BitmapRef source;
+	unsigned srcX, srcY;
+
+	ImageOpacity coverage;
 };
 
 #endif
@@ -0,0 +1,58 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-opacity.cpp                   **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <algorithm>
+
+#include <Gosu/Bitmap.hpp>
+
+#include "gosu-opacity.h"
+
+ImageOpacity bitmapOpacity(const Gosu::Bitmap& bitmap,
+                           unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	unsigned x2 = std::min(x + w, bitmap.width());
+	unsigned y2 = std::min(y + h, bitmap.height());
+	if (x >= x2 || y >= y2)
+		return IMAGE_TRANSPARENT;
+
+	bool seenOpaque = false, seenClear = x2 - x < w || y2 - y < h;
+	const Gosu::Color* pixels = bitmap.data();
+	for (unsigned py = y; py < y2; py++) {
+		const Gosu::Color* row = pixels + py * bitmap.width();
+		for (unsigned px = x; px < x2; px++) {
+			Gosu::Color::Channel a = row[px].alpha();
+			if (a != 255)
+				seenClear = true;
+			if (a != 0)
+				seenOpaque = true;
+			if (seenClear && seenOpaque)
+				return IMAGE_MIXED;
+		}
+	}
+	return seenOpaque ? IMAGE_OPAQUE : IMAGE_TRANSPARENT;
+}
+
@@ -0,0 +1,709 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-renderer.cpp                  **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include <Gosu/Graphics.hpp>
+#include <Gosu/Image.hpp>
+#include <Gosu/ImageData.hpp>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glext.h>
+#else
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include "gosu-renderer.h"
+#include "gosu-residency.h"
+#include "gosu-thread.h"
+#include "gosu-window.h"
+
+/*
+ * Sort keys are packed into 64 bits, from most to least significant:
+ *
+ *   16 bits  bucket (depth)
+ *    8 bits  barrier count
+ *   16 bits  texture slot
+ *   24 bits  index into sprites
+ *
+ * The index keeps the sort stable. Draws that don't fit are passed
+ * straight to Gosu.
+ */
+#define KEY_BUCKET_SHIFT  48
+#define KEY_BARRIER_SHIFT 40
+#define KEY_TEX_SHIFT     24
+#define MAX_BUCKETS  0xFFFF
+#define MAX_BARRIERS 0xFF
+#define MAX_TEXTURES 0xFFFF
+#define MAX_SPRITES  0xFFFFFF
+#define KEY_INDEX_MASK 0xFFFFFF
+
+// Only the bytes above the index need sorting.
+#define KEY_FIRST_SORT_BYTE 3
+#define KEY_BYTES 8
+
+
+Renderer& Renderer::instance()
+{
+	return RendererImpl::instance();
+}
+
+RendererImpl& RendererImpl::instance()
+{
+	static RendererImpl globalRenderer;
+	return globalRenderer;
+}
+
+RendererImpl::RendererImpl()
+	: recording(&frames[0]), shown(&frames[1]), shownPresented(true),
+	  barriers(0), offscreen(false),
+	  lastTargetX(0.0), lastTargetY(0.0), lastTargetW(0), lastTargetH(0),
+	  topDepth(0.0), compositeDepth(0.0), targetValid(false),
+	  offscreenSupport(-1), targetLost(false),
+	  fboW(0), fboH(0), fbo(0), fboTex(0), targetCleared(false)
+{
+	for (int i = 0; i < 2; i++) {
+		frames[i].sorted = true;
+		frames[i].targetX = frames[i].targetY = 0.0;
+		frames[i].targetW = frames[i].targetH = 0;
+		frames[i].partial = false;
+	}
+}
+
+void RendererImpl::beginFrame()
+{
+	Frame& f = *recording;
+	f.sprites.clear();
+	f.keys.clear();
+	f.buckets.clear();
+	f.ops.clear();
+	f.transforms.clear();
+	f.sorted = false;
+	f.targetW = f.targetH = 0;
+	f.partial = false;
+	bucketsByDepth.clear();
+	texSlots.clear();
+	barriers = 0;
+	offscreen = false;
+	deferred.clear();
+
+	ResidencyGroup::nextFrame();
+}
+
+void RendererImpl::barrier()
+{
+	barriers++;
+}
+
+RendererImpl::Op& RendererImpl::record(OpType type, double z)
+{
+	// The last frame is finished. Start a new one.
+	if (recording->sorted)
+		beginFrame();
+
+	Op op;
+	op.type = type;
+	op.index = 0;
+	op.img = NULL;
+	op.x = op.y = op.w = op.h = 0.0;
+	op.z = z;
+	recording->ops.push_back(op);
+	return recording->ops.back();
+}
+
+void RendererImpl::draw(const Gosu::Image& img, double x, double y, double z)
+{
+	if (recording->sorted)
+		beginFrame();
+	Frame& f = *recording;
+
+	const Gosu::GLTexInfo* info = img.getData().glTexInfo();
+	if (!info || f.sprites.size() >= MAX_SPRITES ||
+			barriers > MAX_BARRIERS) {
+		// Spans several textures or we're full.
+		drawDirect(img, x, y, z);
+		return;
+	}
+
+	unsigned slot = textureSlot((unsigned)info->texName);
+	if (slot > MAX_TEXTURES) {
+		drawDirect(img, x, y, z);
+		return;
+	}
+
+	unsigned bucket;
+	std::unordered_map<double, unsigned>::iterator it;
+	it = bucketsByDepth.find(z);
+	if (it != bucketsByDepth.end())
+		bucket = it->second;
+	else {
+		if (f.buckets.size() > MAX_BUCKETS) {
+			drawDirect(img, x, y, z);
+			return;
+		}
+		bucket = (unsigned)f.buckets.size();
+		Bucket b = { 0, 0, offscreen };
+		f.buckets.push_back(b);
+		bucketsByDepth[z] = bucket;
+		if (offscreen)
+			topDepth = std::max(topDepth, z);
+
+		record(OP_BUCKET, z).index = bucket;
+	}
+
+	Sprite s;
+	s.x1 = (float)x;
+	s.y1 = (float)y;
+	s.x2 = (float)(x + img.width());
+	s.y2 = (float)(y + img.height());
+	s.u1 = info->left;
+	s.v1 = info->top;
+	s.u2 = info->right;
+	s.v2 = info->bottom;
+	s.tex = (unsigned)info->texName;
+
+	uint64_t key = (uint64_t)bucket << KEY_BUCKET_SHIFT |
+	               (uint64_t)barriers << KEY_BARRIER_SHIFT |
+	               (uint64_t)slot << KEY_TEX_SHIFT |
+	               (uint64_t)f.sprites.size();
+	f.sprites.push_back(s);
+	f.keys.push_back(key);
+}
+
+void RendererImpl::drawDirect(const Gosu::Image& img, double x, double y,
+                              double z)
+{
+	if (offscreen) {
+		Deferred d = { &img, x, y, z };
+		deferred.push_back(d);
+	}
+	else {
+		Op& op = record(OP_IMAGE, z);
+		op.img = &img;
+		op.x = x;
+		op.y = y;
+	}
+}
+
+void RendererImpl::drawClipped(const Gosu::Image& img,
+                               double x, double y, double z,
+                               double clipX, double clipY,
+                               double clipW, double clipH)
+{
+	pushClip(clipX, clipY, clipW, clipH);
+	Op& op = record(OP_IMAGE, z);
+	op.img = &img;
+	op.x = x;
+	op.y = y;
+	popClip();
+}
+
+void RendererImpl::drawRect(double x1, double x2, double y1, double y2,
+                            Gosu::Color c, double z)
+{
+	Op& op = record(OP_QUAD, z);
+	op.x = x1;
+	op.y = y1;
+	op.w = x2 - x1;
+	op.h = y2 - y1;
+	op.color = c;
+}
+
+void RendererImpl::pushClip(double x, double y, double w, double h)
+{
+	Op& op = record(OP_BEGIN_CLIP, 0.0);
+	op.x = x;
+	op.y = y;
+	op.w = w;
+	op.h = h;
+}
+
+void RendererImpl::popClip()
+{
+	record(OP_END_CLIP, 0.0);
+}
+
+void RendererImpl::pushTransform(const Gosu::Transform& t)
+{
+	record(OP_PUSH_TRANSFORM, 0.0).index =
+		(unsigned)recording->transforms.size();
+	recording->transforms.push_back(t);
+}
+
+void RendererImpl::popTransform()
+{
+	record(OP_POP_TRANSFORM, 0.0);
+}
+
+bool RendererImpl::DeferredOrder::operator()(const Deferred& a,
+                                             const Deferred& b) const
+{
+	return a.z < b.z;
+}
+
+bool RendererImpl::beginOffscreen(double x, double y, unsigned w, unsigned h)
+{
+	if (recording->sorted)
+		beginFrame();
+	if (offscreen || w == 0 || h == 0 || !canRenderOffscreen())
+		return false;
+
+	// The last frame's pixels are still good if they are of the same
+	// part of the world and made it to the screen.
+	bool moved = x != lastTargetX || y != lastTargetY ||
+	             w != lastTargetW || h != lastTargetH;
+	if (moved || targetLost.exchange(false))
+		targetValid = false;
+
+	Frame& f = *recording;
+	offscreen = true;
+	f.partial = false;
+	f.targetX = lastTargetX = x;
+	f.targetY = lastTargetY = y;
+	f.targetW = lastTargetW = w;
+	f.targetH = lastTargetH = h;
+	topDepth = -std::numeric_limits<double>::max();
+
+	// Buckets started before now draw to the window.
+	bucketsByDepth.clear();
+	return true;
+}
+
+void RendererImpl::endOffscreen()
+{
+	if (!offscreen)
+		return;
+	offscreen = false;
+	Frame& f = *recording;
+	const double none = -std::numeric_limits<double>::max();
+
+	// Held-back Images keep their own depths. Whatever would have gone in
+	// the target at or above the lowest of them is drawn to the window
+	// instead, and the target goes in below it. A partial frame only drew
+	// the damaged parts of those, so there the Images go over the target
+	// for this one frame.
+	std::stable_sort(deferred.begin(), deferred.end(), DeferredOrder());
+	double z = topDepth;
+	if (deferred.size() && !f.partial) {
+		double lowest = deferred.front().z;
+		z = none;
+		std::unordered_map<double, unsigned>::iterator it;
+		for (it = bucketsByDepth.begin(); it != bucketsByDepth.end();
+				it++) {
+			if (it->first >= lowest)
+				f.buckets[it->second].offscreen = false;
+			else
+				z = std::max(z, it->first);
+		}
+	}
+	bucketsByDepth.clear();
+
+	// A partial redraw may not have drawn anything but still shows the
+	// target.
+	if (z == none && f.partial)
+		z = compositeDepth;
+	bool composited = z != none;
+
+	// Held-back Images go to the window, which is drawn in full every
+	// frame. A partial frame would leave out the ones not damaged, so
+	// the next frame is drawn in full.
+	targetValid = composited && deferred.empty();
+	if (composited) {
+		compositeDepth = z;
+
+		// Gosu runs blocks of equal depth in the order they were
+		// scheduled, so this comes after every offscreen bucket.
+		record(OP_COMPOSITE, z);
+	}
+
+	for (std::vector<Deferred>::iterator it = deferred.begin();
+			it != deferred.end(); it++) {
+		Deferred& d = *it;
+		Op& op = record(OP_IMAGE, f.partial && composited ? z : d.z);
+		op.img = d.img;
+		op.x = d.x;
+		op.y = d.y;
+	}
+	deferred.clear();
+}
+
+bool RendererImpl::setDamage(const std::vector<DamageRect>& rects)
+{
+	if (!offscreen || !targetValid)
+		return false;
+
+	// Round outwards to whole pixels. OpenGL counts rows from the bottom.
+	Frame& f = *recording;
+	f.scissors.clear();
+	for (size_t i = 0; i < rects.size(); i++) {
+		const DamageRect& r = rects[i];
+		int x1 = std::max(0, (int)floor(r.x1 - f.targetX));
+		int y1 = std::max(0, (int)floor(r.y1 - f.targetY));
+		int x2 = std::min((int)f.targetW, (int)ceil(r.x2 - f.targetX));
+		int y2 = std::min((int)f.targetH, (int)ceil(r.y2 - f.targetY));
+		if (x1 >= x2 || y1 >= y2)
+			continue;
+		f.scissors.push_back(x1);
+		f.scissors.push_back((int)f.targetH - y2);
+		f.scissors.push_back(x2 - x1);
+		f.scissors.push_back(y2 - y1);
+	}
+	f.partial = true;
+	return true;
+}
+
+void RendererImpl::finishFrame()
+{
+	if (!recording->sorted)
+		sort(*recording);
+}
+
+void RendererImpl::swapFrames()
+{
+	finishFrame();
+	if (!shownPresented)
+		targetLost = true;
+	std::swap(recording, shown);
+	shownPresented = false;
+}
+
+bool RendererImpl::framePending() const
+{
+	return !shownPresented;
+}
+
+void RendererImpl::present()
+{
+	shownPresented = true;
+	targetCleared = false;
+
+	// Frames may be recorded away from OpenGL, so ask for them here.
+	canRenderOffscreen();
+
+	Gosu::Graphics& graphics = GameWindowImpl::instance().graphics();
+	const Frame& f = *shown;
+	for (size_t i = 0; i < f.ops.size(); i++) {
+		const Op& op = f.ops[i];
+		switch (op.type) {
+		case OP_BUCKET:
+			graphics.scheduleGL(std::bind(&RendererImpl::submit,
+				this, op.index), op.z);
+			break;
+		case OP_IMAGE:
+			op.img->draw(op.x, op.y, op.z);
+			break;
+		case OP_QUAD:
+			graphics.drawQuad(
+				op.x, op.y, op.color,
+				op.x + op.w, op.y, op.color,
+				op.x + op.w, op.y + op.h, op.color,
+				op.x, op.y + op.h, op.color,
+				op.z
+			);
+			break;
+		case OP_BEGIN_CLIP:
+			graphics.beginClipping(op.x, op.y, op.w, op.h);
+			break;
+		case OP_END_CLIP:
+			graphics.endClipping();
+			break;
+		case OP_PUSH_TRANSFORM:
+			graphics.pushTransform(f.transforms[op.index]);
+			break;
+		case OP_POP_TRANSFORM:
+			graphics.popTransform();
+			break;
+		case OP_COMPOSITE:
+			graphics.scheduleGL(std::bind(&RendererImpl::composite,
+				this), op.z);
+			break;
+		}
+	}
+}
+
+bool RendererImpl::canRenderOffscreen()
+{
+#ifdef _WIN32
+	// opengl32.dll doesn't export the framebuffer object functions.
+	return false;
+#else
+	if (offscreenSupport < 0 && onGLThread()) {
+		const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+		offscreenSupport =
+			ext && strstr(ext, "GL_EXT_framebuffer_object") ? 1 : 0;
+	}
+	return offscreenSupport == 1;
+#endif
+}
+
+void RendererImpl::bindTarget()
+{
+#ifndef _WIN32
+	const Frame& f = *shown;
+	unsigned targetW = f.targetW;
+	unsigned targetH = f.targetH;
+
+	if (!fbo)
+		glGenFramebuffersEXT(1, &fbo);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+
+	if (fboW != targetW || fboH != targetH) {
+		if (!fboTex)
+			glGenTextures(1, &fboTex);
+		glBindTexture(GL_TEXTURE_2D, fboTex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+		             (GLsizei)targetW, (GLsizei)targetH, 0,
+		             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+		                          GL_COLOR_ATTACHMENT0_EXT,
+		                          GL_TEXTURE_2D, fboTex, 0);
+		fboW = targetW;
+		fboH = targetH;
+
+		// Fall back to drawing straight to the window from the next
+		// frame on.
+		if (glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) !=
+				GL_FRAMEBUFFER_COMPLETE_EXT)
+			offscreenSupport = 0;
+	}
+
+	// Gosu's viewport, projection, transform and clipping are all for
+	// the window. Swap in ones that map the target's corner to (0, 0).
+	glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT |
+	             GL_SCISSOR_BIT);
+	glDisable(GL_SCISSOR_TEST);
+	glViewport(0, 0, (GLsizei)targetW, (GLsizei)targetH);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, targetW, targetH, 0.0, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glTranslated(-f.targetX, -f.targetY, 0.0);
+
+	if (!targetCleared) {
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		if (f.partial) {
+			glEnable(GL_SCISSOR_TEST);
+			for (size_t i = 0; i < f.scissors.size(); i += 4) {
+				glScissor(f.scissors[i], f.scissors[i + 1],
+				          f.scissors[i + 2], f.scissors[i + 3]);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
+			glDisable(GL_SCISSOR_TEST);
+		}
+		else
+			glClear(GL_COLOR_BUFFER_BIT);
+		targetCleared = true;
+	}
+#endif
+}
+
+void RendererImpl::unbindTarget()
+{
+#ifndef _WIN32
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+#endif
+}
+
+void RendererImpl::composite()
+{
+	// Gosu has applied the World's transform and letterbox clipping, so
+	// the target goes back exactly where its contents were drawn.
+	const Frame& f = *shown;
+	float x1 = (float)f.targetX;
+	float y1 = (float)f.targetY;
+	float x2 = (float)(f.targetX + f.targetW);
+	float y2 = (float)(f.targetY + f.targetH);
+
+	// Nothing was drawn, but damaged parts still need clearing.
+	if (!targetCleared) {
+		bindTarget();
+		unbindTarget();
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glEnable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_2D, fboTex);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+	// Rows of the target are stored bottom-up.
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 1.0f); glVertex2f(x1, y1);
+	glTexCoord2f(1.0f, 1.0f); glVertex2f(x2, y1);
+	glTexCoord2f(1.0f, 0.0f); glVertex2f(x2, y2);
+	glTexCoord2f(0.0f, 0.0f); glVertex2f(x1, y2);
+	glEnd();
+
+	glPopAttrib();
+}
+
+unsigned RendererImpl::textureSlot(unsigned tex)
+{
+	std::unordered_map<unsigned, unsigned>::iterator it;
+	it = texSlots.find(tex);
+	if (it != texSlots.end())
+		return it->second;
+	unsigned slot = (unsigned)texSlots.size();
+	texSlots[tex] = slot;
+	return slot;
+}
+
+void RendererImpl::sort(Frame& frame)
+{
+	std::vector<uint64_t>& keys = frame.keys;
+	std::vector<Bucket>& buckets = frame.buckets;
+	frame.sorted = true;
+	if (keys.empty())
+		return;
+
+	// Least significant digit radix sort, one byte at a time. Passes
+	// where every key has the same byte are skipped.
+	scratch.resize(keys.size());
+	for (int byte = KEY_FIRST_SORT_BYTE; byte < KEY_BYTES; byte++) {
+		int shift = byte * 8;
+		size_t counts[256] = {0};
+		for (size_t i = 0; i < keys.size(); i++)
+			counts[(keys[i] >> shift) & 0xFF]++;
+		if (counts[(keys[0] >> shift) & 0xFF] == keys.size())
+			continue;
+
+		size_t pos = 0;
+		for (int d = 0; d < 256; d++) {
+			size_t count = counts[d];
+			counts[d] = pos;
+			pos += count;
+		}
+		for (size_t i = 0; i < keys.size(); i++)
+			scratch[counts[(keys[i] >> shift) & 0xFF]++] = keys[i];
+		keys.swap(scratch);
+	}
+
+	for (size_t i = 0; i < keys.size(); ) {
+		size_t b = (size_t)(keys[i] >> KEY_BUCKET_SHIFT);
+		buckets[b].begin = i;
+		while (i < keys.size() &&
+		       (size_t)(keys[i] >> KEY_BUCKET_SHIFT) == b)
+			i++;
+		buckets[b].end = i;
+	}
+}
+
+void RendererImpl::submit(unsigned bucket)
+{
+	const Frame& f = *shown;
+	const Bucket& b = f.buckets[bucket];
+	size_t count = b.end - b.begin;
+	if (b.offscreen)
+		bindTarget();
+
+	vertices.resize(count * 8);
+	texCoords.resize(count * 8);
+	float* v = vertices.data();
+	float* t = texCoords.data();
+	for (size_t i = b.begin; i < b.end; i++) {
+		const Sprite& s = f.sprites[f.keys[i] & KEY_INDEX_MASK];
+		v[0] = s.x1; v[1] = s.y1;  t[0] = s.u1; t[1] = s.v1;
+		v[2] = s.x2; v[3] = s.y1;  t[2] = s.u2; t[3] = s.v1;
+		v[4] = s.x2; v[5] = s.y2;  t[4] = s.u2; t[5] = s.v2;
+		v[6] = s.x1; v[7] = s.y2;  t[6] = s.u1; t[7] = s.v2;
+		v += 8;
+		t += 8;
+	}
+
+	// Gosu has applied the transform and clipping for this depth. It
+	// resets its own state after we return.
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+	glTexCoordPointer(2, GL_FLOAT, 0, texCoords.data());
+
+	if (b.offscreen && f.partial) {
+		glEnable(GL_SCISSOR_TEST);
+		for (size_t i = 0; i < f.scissors.size(); i += 4) {
+			glScissor(f.scissors[i], f.scissors[i + 1],
+			          f.scissors[i + 2], f.scissors[i + 3]);
+			drawRuns(b);
+		}
+	}
+	else
+		drawRuns(b);
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if (b.offscreen)
+		unbindTarget();
+}
+
+void RendererImpl::drawRuns(const Bucket& b)
+{
+	const std::vector<Sprite>& sprites = shown->sprites;
+	const std::vector<uint64_t>& keys = shown->keys;
+	size_t count = b.end - b.begin;
+
+	// One call per run of sprites sharing a texture.
+	size_t run = 0;
+	while (run < count) {
+		unsigned tex = sprites[keys[b.begin + run] & KEY_INDEX_MASK].tex;
+		size_t end = run + 1;
+		while (end < count &&
+		       sprites[keys[b.begin + end] & KEY_INDEX_MASK].tex == tex)
+			end++;
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glDrawArrays(GL_QUADS, (GLint)(run * 4),
+		             (GLsizei)((end - run) * 4));
+		run = end;
+	}
+}
+
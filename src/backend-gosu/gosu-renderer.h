@@ -0,0 +1,234 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-renderer.h                    **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef GOSU_RENDERER_H
+#define GOSU_RENDERER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include <Gosu/Color.hpp>
+#include <Gosu/Graphics.hpp> // for Gosu::Transform
+
+#include "../renderer.h"
+
+namespace Gosu { class Image; }
+
+/**
+ * Records Image draws into a command buffer instead of handing each one to
+ * Gosu. Draws are bucketed by depth; Gosu only sees and sorts one OpenGL
+ * block per bucket, which in turn draws its sprites grouped by texture from
+ * vertex arrays.
+ *
+ * Everything drawn at one depth must share the transform and clipping that
+ * were in effect when the first Image was drawn at that depth.
+ *
+ * Between beginOffscreen() and endOffscreen(), buckets draw into a texture
+ * through a framebuffer object instead. Images that Gosu had to split over
+ * several textures can't go there; they are held back and drawn to the
+ * window at their own depths, along with the buckets at and above them.
+ *
+ * The target outlives the frame. If it hasn't moved since, a frame can
+ * redraw just its damaged parts by scissoring every bucket to them.
+ *
+ * Nothing reaches Gosu while a frame is recorded, so recording needs no
+ * OpenGL context. Rectangles, clipping and transforms are recorded along
+ * with the Images. Two frames are kept: one being recorded, and a finished
+ * one that present() replays into Gosu from the thread that owns OpenGL.
+ */
+class RendererImpl : public Renderer
+{
+public:
+	static RendererImpl& instance();
+
+	RendererImpl();
+
+	void beginFrame();
+	void barrier();
+
+	bool beginOffscreen(double x, double y, unsigned w, unsigned h);
+	void endOffscreen();
+	bool setDamage(const std::vector<DamageRect>& rects);
+
+	//! Queue an Image to be drawn with its upper-left corner at (x, y).
+	void draw(const Gosu::Image& img, double x, double y, double z);
+
+	//! Queue an Image to be drawn clipped to a rectangle. Not batched.
+	void drawClipped(const Gosu::Image& img, double x, double y, double z,
+	                 double clipX, double clipY,
+	                 double clipW, double clipH);
+
+	//! Record the GameWindow's drawing calls. See GameWindow.
+	void drawRect(double x1, double x2, double y1, double y2,
+	              Gosu::Color c, double z);
+	void pushClip(double x, double y, double w, double h);
+	void popClip();
+	void pushTransform(const Gosu::Transform& t);
+	void popTransform();
+
+	//! Done recording. Sorts the frame so present() has less to do.
+	void finishFrame();
+
+	//! Make the frame just finished the one to present, and record the
+	//! next one over the frame presented before it.
+	void swapFrames();
+
+	//! Has the frame from the last swapFrames() yet to be presented?
+	bool framePending() const;
+
+	//! Hand the finished frame to Gosu. Call from the window's draw
+	//! callback.
+	void present();
+
+private:
+	struct Sprite {
+		float x1, y1, x2, y2;
+		float u1, v1, u2, v2;
+		unsigned tex;
+	};
+
+	struct Bucket {
+		size_t begin, end; //!< Range in order after sorting.
+		bool offscreen;
+	};
+
+	//! A call into Gosu, made when the frame is presented.
+	enum OpType {
+		OP_BUCKET,         //!< Schedule a bucket's OpenGL block.
+		OP_IMAGE,          //!< Let Gosu draw an Image.
+		OP_QUAD,           //!< Solid rectangle.
+		OP_BEGIN_CLIP,
+		OP_END_CLIP,
+		OP_PUSH_TRANSFORM,
+		OP_POP_TRANSFORM,
+		OP_COMPOSITE       //!< Draw the offscreen target back.
+	};
+
+	struct Op {
+		OpType type;
+		unsigned index; //!< Bucket, or entry in Frame::transforms.
+		const Gosu::Image* img;
+		double x, y, w, h, z;
+		Gosu::Color color;
+	};
+
+	//! Everything recorded for one frame.
+	struct Frame {
+		std::vector<Sprite> sprites;
+		std::vector<uint64_t> keys; //!< One per Sprite. See draw().
+		std::vector<Bucket> buckets;
+		std::vector<Op> ops;
+		std::vector<Gosu::Transform> transforms;
+		bool sorted;
+
+		// Offscreen target. See beginOffscreen().
+		double targetX, targetY; //!< Drawing coordinates of its corner.
+		unsigned targetW, targetH; //!< Size in use this frame.
+		bool partial; //!< Only damaged parts are drawn this frame.
+		std::vector<int> scissors; //!< Damage as x, y, w, h in target pixels.
+	};
+
+	//! An Image left for Gosu to draw after the offscreen target.
+	struct Deferred {
+		const Gosu::Image* img;
+		double x, y, z;
+	};
+
+	//! Orders Deferred draws by depth.
+	struct DeferredOrder {
+		bool operator()(const Deferred& a, const Deferred& b) const;
+	};
+
+	//! Append an Op to the frame being recorded.
+	Op& record(OpType type, double z);
+
+	//! Hand an Image to Gosu, or hold it back while offscreen.
+	void drawDirect(const Gosu::Image& img, double x, double y, double z);
+
+	//! Called by Gosu in depth order while it flushes the frame.
+	void submit(unsigned bucket);
+	//! Issue the draw calls for a bucket whose vertices are loaded.
+	void drawRuns(const Bucket& b);
+
+	//! Order every queued Sprite by bucket, barrier and texture.
+	void sort(Frame& frame);
+
+	unsigned textureSlot(unsigned tex);
+
+	//! Does the OpenGL driver have framebuffer objects? Only known once
+	//! asked from the thread that owns OpenGL.
+	bool canRenderOffscreen();
+
+	//! Redirect OpenGL to the target, creating or resizing it as needed.
+	//! Called from inside a Gosu OpenGL block.
+	void bindTarget();
+	void unbindTarget();
+
+	//! Called by Gosu after every offscreen bucket to stretch the target
+	//! over the window.
+	void composite();
+
+	Frame frames[2];
+	Frame* recording;
+	Frame* shown; //!< Read by present() and the blocks it schedules.
+	bool shownPresented;
+
+	// Used while recording.
+	std::vector<uint64_t> scratch;
+	std::unordered_map<double, unsigned> bucketsByDepth;
+	std::unordered_map<unsigned, unsigned> texSlots;
+	unsigned barriers; //!< Number of barrier() calls this frame.
+	bool offscreen;
+	double lastTargetX, lastTargetY;
+	unsigned lastTargetW, lastTargetH;
+	double topDepth; //!< Deepest bucket drawn offscreen.
+	double compositeDepth; //!< Where the target was last drawn back.
+	bool targetValid; //!< Holds the last frame recorded.
+	std::vector<Deferred> deferred;
+
+	//! -1 until asked. Cleared by bindTarget() if the target can't be
+	//! used.
+	std::atomic<int> offscreenSupport;
+	//! Set when a frame was swapped out without being presented, so the
+	//! target missed it.
+	std::atomic<bool> targetLost;
+
+	// Used while presenting.
+	unsigned fboW, fboH; //!< Size of the texture allocated.
+	unsigned fbo, fboTex;
+	bool targetCleared;
+
+	// Vertex arrays handed to OpenGL. Kept between calls to avoid
+	// reallocation.
+	std::vector<float> vertices;
+	std::vector<float> texCoords;
+};
+
+#endif
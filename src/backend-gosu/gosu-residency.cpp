@@ -0,0 +1,219 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-residency.cpp                 **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include <Gosu/Bitmap.hpp>
+
+#include "gosu-image.h"
+#include "gosu-residency.h"
+#include "gosu-texture.h"
+#include "../client-conf.h"
+#include "../formatter.h"
+#include "../log.h"
+
+// Most bytes of queued textures to upload each frame. At least one group
+// is always uploaded.
+#define UPLOAD_BYTES_PER_FRAME (2 * 1024 * 1024)
+
+// Guards everything below and every group's residency.
+static std::mutex lock;
+static std::vector<ResidencyGroup*> groups;
+static std::deque<ResidencyGroup*> queue;
+static size_t residentBytes = 0;
+static unsigned long frame = 1;
+
+
+ResidencyGroup::ResidencyGroup(const std::string& name, const BitmapRef& bitmap)
+	: name(name), bitmap(bitmap), texBytes(0), lastUsed(0), pins(0),
+	  resident(false), logged(false)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	groups.push_back(this);
+}
+
+ResidencyGroup::~ResidencyGroup()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	groups.erase(std::find(groups.begin(), groups.end(), this));
+	std::deque<ResidencyGroup*>::iterator it;
+	it = std::find(queue.begin(), queue.end(), this);
+	if (it != queue.end())
+		queue.erase(it);
+	if (resident)
+		residentBytes -= texBytes;
+}
+
+void ResidencyGroup::add(ImageImpl* img)
+{
+	members.push_back(img);
+}
+
+void ResidencyGroup::remove(ImageImpl* img)
+{
+	std::vector<ImageImpl*>::iterator it;
+	it = std::find(members.begin(), members.end(), img);
+	if (it != members.end()) {
+		*it = members.back();
+		members.pop_back();
+	}
+}
+
+void ResidencyGroup::touch()
+{
+	lastUsed = frame;
+	if (!resident)
+		upload();
+}
+
+void ResidencyGroup::pin()
+{
+	pins++;
+	if (!resident)
+		upload();
+}
+
+void ResidencyGroup::unpin()
+{
+	pins--;
+}
+
+void ResidencyGroup::queueUpload()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	queue.push_back(this);
+}
+
+void ResidencyGroup::upload()
+{
+	if (resident)
+		return;
+
+	CompactTextureRef texture;
+	if (conf.compactTextures)
+		texture = CompactTexture::create(*bitmap);
+	for (size_t i = 0; i < members.size(); i++)
+		members[i]->upload(texture);
+
+	std::lock_guard<std::mutex> guard(lock);
+	texBytes = texture ? texture->bytes() : fullBytes();
+	residentBytes += texBytes;
+	resident = true;
+
+	if (texture && !logged) {
+		Log::info("Residency", Formatter(
+			"%: stored in % KiB of video memory instead of % KiB")
+			% name % (long)(texBytes / 1024)
+			% (long)(fullBytes() / 1024));
+		logged = true;
+	}
+}
+
+void ResidencyGroup::evict()
+{
+	if (!resident)
+		return;
+
+	// Textures are freed once no frame waiting to be presented can use
+	// them.
+	for (size_t i = 0; i < members.size(); i++)
+		members[i]->evict();
+
+	std::lock_guard<std::mutex> guard(lock);
+	residentBytes -= texBytes;
+	resident = false;
+}
+
+size_t ResidencyGroup::fullBytes() const
+{
+	return (size_t)bitmap->width() * bitmap->height() * 4;
+}
+
+static bool leastRecentlyUsed(const std::pair<unsigned long, ResidencyGroup*>& a,
+                              const std::pair<unsigned long, ResidencyGroup*>& b)
+{
+	return a.first < b.first;
+}
+
+void ResidencyGroup::nextFrame()
+{
+	frame++;
+	uploadQueued();
+	if (conf.cacheVideoMemory > 0)
+		enforceBudget();
+}
+
+void ResidencyGroup::uploadQueued()
+{
+	size_t uploaded = 0;
+	while (uploaded < UPLOAD_BYTES_PER_FRAME) {
+		ResidencyGroup* g;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (queue.empty())
+				return;
+			g = queue.front();
+			queue.pop_front();
+		}
+		if (!g->resident) {
+			g->upload();
+			uploaded += g->texBytes;
+		}
+	}
+}
+
+void ResidencyGroup::enforceBudget()
+{
+	size_t budget = (size_t)conf.cacheVideoMemory * 1024 * 1024;
+	std::vector<std::pair<unsigned long, ResidencyGroup*> > victims;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (residentBytes <= budget)
+			return;
+
+		// Anything drawn last frame will likely be drawn again.
+		for (size_t i = 0; i < groups.size(); i++) {
+			ResidencyGroup* g = groups[i];
+			if (g->resident && g->pins == 0 &&
+			    g->lastUsed + 1 < frame)
+				victims.push_back(std::make_pair(g->lastUsed, g));
+		}
+	}
+	std::sort(victims.begin(), victims.end(), leastRecentlyUsed);
+
+	size_t before = residentBytes;
+	for (size_t i = 0; i < victims.size() && residentBytes > budget; i++)
+		victims[i].second->evict();
+
+	if (residentBytes < before)
+		Log::info("Residency", Formatter(
+			"evicted % KiB of textures, % KiB still uploaded")
+			% (long)((before - residentBytes) / 1024)
+			% (long)(residentBytes / 1024));
+}
+
@@ -0,0 +1,108 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-residency.h                   **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef GOSU_RESIDENCY_H
+#define GOSU_RESIDENCY_H
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Gosu { class Bitmap; }
+
+class ImageImpl;
+
+/**
+ * Images cut from one bitmap, such as the tiles of a tileset, whose
+ * textures are uploaded and evicted together. An Image read on its own,
+ * such as a sprite, is a group of one.
+ *
+ * New groups wait in a queue, which is worked through a few at a time at
+ * the start of each frame, so that loading many at once doesn't stall
+ * drawing. Drawing or pinning one uploads it right away.
+ *
+ * Uploaded groups count against the "[cache] videomemory" budget. At the
+ * start of each frame, if we're over it, groups that are unpinned and
+ * weren't drawn in the last frame are evicted, least recently drawn first.
+ * Their pixels stay in main memory, and drawing one of their Images
+ * uploads them all again.
+ *
+ * Groups can be made and queued on any thread, but only the thread that
+ * records frames may draw, pin or unpin them.
+ */
+class ResidencyGroup
+{
+public:
+	//! name is only used in logs.
+	ResidencyGroup(const std::string& name,
+	               const std::shared_ptr<Gosu::Bitmap>& bitmap);
+	~ResidencyGroup();
+
+	//! Images join before the first upload and leave when destroyed.
+	void add(ImageImpl* img);
+	void remove(ImageImpl* img);
+
+	//! About to be drawn. Uploads us if we were evicted.
+	void touch();
+
+	//! Pinned groups are uploaded now and never evicted. Pins are
+	//! counted.
+	void pin();
+	void unpin();
+
+	//! Upload when our turn in the queue comes.
+	void queueUpload();
+
+	void upload();
+	void evict();
+
+	//! Video memory Gosu would take for us.
+	size_t fullBytes() const;
+
+	//! Count a new frame, work through some of the queue, and evict what
+	//! we can if we're over budget.
+	static void nextFrame();
+
+private:
+	static void uploadQueued();
+	static void enforceBudget();
+
+	std::string name;
+	std::shared_ptr<Gosu::Bitmap> bitmap;
+	std::vector<ImageImpl*> members;
+	size_t texBytes;
+	unsigned long lastUsed;
+	int pins;
+	bool resident;
+	bool logged;
+};
+
+typedef std::shared_ptr<ResidencyGroup> ResidencyGroupRef;
+
+#endif
+
@@ -0,0 +1,487 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-texture.cpp                   **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <Gosu/Bitmap.hpp>
+#include <Gosu/Graphics.hpp>
+#include <Gosu/Image.hpp>
+#include <Gosu/ImageData.hpp>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glext.h>
+#else
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include "gosu-texture.h"
+#include "gosu-thread.h"
+#include "gosu-window.h"
+
+// From GL_OES_compressed_paletted_texture.
+#ifndef GL_PALETTE4_RGBA8_OES
+#define GL_PALETTE4_RGBA8_OES 0x8B91
+#define GL_PALETTE8_RGBA8_OES 0x8B96
+#endif
+
+#define PALETTE4_COLORS 16
+#define PALETTE8_COLORS 256
+
+
+// What OpenGL can do. Looked up once, from the thread that owns it.
+static std::atomic<bool> capsKnown(false);
+static bool palettes;
+static bool anySize;
+static unsigned maxSize;
+
+static void queryCaps()
+{
+	if (capsKnown)
+		return;
+
+	const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+	const char* version = (const char*)glGetString(GL_VERSION);
+#ifdef _WIN32
+	// opengl32.dll doesn't export glCompressedTexImage2D.
+	palettes = false;
+#else
+	palettes = ext && strstr(ext, "GL_OES_compressed_paletted_texture");
+#endif
+	anySize = (version && version[0] >= '2') ||
+		(ext && strstr(ext, "GL_ARB_texture_non_power_of_two"));
+
+	GLint size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+	maxSize = (unsigned)size;
+
+	capsKnown = true;
+}
+
+static unsigned powerOfTwo(unsigned n)
+{
+	unsigned p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+static size_t formatBytes(TextureFormat fmt, unsigned w, unsigned h)
+{
+	size_t pixels = (size_t)w * h;
+	switch (fmt) {
+	case TEX_PALETTE4:
+		return PALETTE4_COLORS * 4 + (pixels + 1) / 2;
+	case TEX_PALETTE8:
+		return PALETTE8_COLORS * 4 + pixels;
+	case TEX_RGBA4:
+	case TEX_RGB5_A1:
+		return pixels * 2;
+	default:
+		return pixels * 4;
+	}
+}
+
+//! Fully transparent pixels look the same whatever their color.
+static inline uint32_t canonical(Gosu::Color c)
+{
+	return c.alpha() == 0 ? 0 : c.argb();
+}
+
+//! Does a channel survive a trip through 4 bits?
+static inline bool fits4(unsigned c)
+{
+	return c % 17 == 0;
+}
+
+//! Does a channel survive a trip through 5 bits?
+static inline bool fits5(unsigned c)
+{
+	return c == ((c & 0xF8) | (c >> 5));
+}
+
+
+//! Image data for part of a CompactTexture.
+class CompactImageData : public Gosu::ImageData
+{
+public:
+	CompactImageData(const CompactTextureRef& texture,
+	                 unsigned texName, unsigned texW, unsigned texH,
+	                 unsigned x, unsigned y, unsigned w, unsigned h);
+
+	int width() const;
+	int height() const;
+
+	void draw(double x1, double y1, Gosu::Color c1,
+	          double x2, double y2, Gosu::Color c2,
+	          double x3, double y3, Gosu::Color c3,
+	          double x4, double y4, Gosu::Color c4,
+	          Gosu::ZPos z, Gosu::AlphaMode mode) const;
+
+	const Gosu::GLTexInfo* glTexInfo() const;
+
+	Gosu::Bitmap toBitmap() const;
+	void insert(const Gosu::Bitmap& bitmap, int x, int y);
+
+private:
+	//! Corners in Gosu's order: top left, top right, bottom left, bottom
+	//! right.
+	struct Quad {
+		double x[4], y[4];
+		Gosu::Color c[4];
+		bool additive;
+	};
+
+	static void drawQuad(const Gosu::GLTexInfo& info, const Quad& q);
+
+	CompactTextureRef texture;
+	Gosu::GLTexInfo info;
+	int w, h;
+};
+
+CompactImageData::CompactImageData(const CompactTextureRef& texture,
+		unsigned texName, unsigned texW, unsigned texH,
+		unsigned x, unsigned y, unsigned w, unsigned h)
+	: texture(texture), w((int)w), h((int)h)
+{
+	info.texName = (int)texName;
+	info.left = (float)x / (float)texW;
+	info.right = (float)(x + w) / (float)texW;
+	info.top = (float)y / (float)texH;
+	info.bottom = (float)(y + h) / (float)texH;
+}
+
+int CompactImageData::width() const
+{
+	return w;
+}
+
+int CompactImageData::height() const
+{
+	return h;
+}
+
+void CompactImageData::draw(double x1, double y1, Gosu::Color c1,
+                            double x2, double y2, Gosu::Color c2,
+                            double x3, double y3, Gosu::Color c3,
+                            double x4, double y4, Gosu::Color c4,
+                            Gosu::ZPos z, Gosu::AlphaMode mode) const
+{
+	Quad q;
+	q.x[0] = x1; q.y[0] = y1; q.c[0] = c1;
+	q.x[1] = x2; q.y[1] = y2; q.c[1] = c2;
+	q.x[2] = x3; q.y[2] = y3; q.c[2] = c3;
+	q.x[3] = x4; q.y[3] = y4; q.c[3] = c4;
+	q.additive = mode == Gosu::amAdditive;
+
+	// Gosu applies the transform and clipping in effect now.
+	Gosu::Graphics& graphics = GameWindowImpl::instance().graphics();
+	graphics.scheduleGL(std::bind(drawQuad, info, q), z);
+}
+
+void CompactImageData::drawQuad(const Gosu::GLTexInfo& info, const Quad& q)
+{
+	static const int order[4] = { 0, 1, 3, 2 };
+	float us[4] = { info.left, info.right, info.left, info.right };
+	float vs[4] = { info.top, info.top, info.bottom, info.bottom };
+
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, q.additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)info.texName);
+
+	glBegin(GL_QUADS);
+	for (int i = 0; i < 4; i++) {
+		int v = order[i];
+		const Gosu::Color& c = q.c[v];
+		glColor4ub(c.red(), c.green(), c.blue(), c.alpha());
+		glTexCoord2f(us[v], vs[v]);
+		glVertex2d(q.x[v], q.y[v]);
+	}
+	glEnd();
+}
+
+const Gosu::GLTexInfo* CompactImageData::glTexInfo() const
+{
+	return &info;
+}
+
+Gosu::Bitmap CompactImageData::toBitmap() const
+{
+	throw std::logic_error("CompactTexture pixels live on the GPU only");
+}
+
+void CompactImageData::insert(const Gosu::Bitmap&, int, int)
+{
+	throw std::logic_error("CompactTexture pixels live on the GPU only");
+}
+
+
+static void deleteTexture(GLuint name)
+{
+	glDeleteTextures(1, &name);
+}
+
+CompactTextureRef CompactTexture::create(const Gosu::Bitmap& bitmap)
+{
+	if (!capsKnown)
+		runOnGLThread(queryCaps);
+
+	unsigned w = bitmap.width(), h = bitmap.height();
+	unsigned texW = anySize ? w : powerOfTwo(w);
+	unsigned texH = anySize ? h : powerOfTwo(h);
+	if (w == 0 || h == 0 || texW > maxSize || texH > maxSize)
+		return CompactTextureRef();
+
+	// One pass over the pixels, stopping once nothing smaller fits.
+	// Pixel art comes in long runs of one color, so only look at each
+	// run once.
+	std::unordered_map<uint32_t, uint8_t> indices;
+	std::vector<uint32_t> palette;
+	bool paletted = palettes, rgba4 = true, rgb5a1 = true;
+
+	const Gosu::Color* pixels = bitmap.data();
+	size_t count = (size_t)w * h;
+	uint32_t last = ~canonical(pixels[0]);
+	for (size_t i = 0; i < count && (paletted || rgba4 || rgb5a1); i++) {
+		uint32_t argb = canonical(pixels[i]);
+		if (argb == last)
+			continue;
+		last = argb;
+
+		if (paletted && indices.find(argb) == indices.end()) {
+			if (palette.size() == PALETTE8_COLORS)
+				paletted = false;
+			else {
+				indices[argb] = (uint8_t)palette.size();
+				palette.push_back(argb);
+			}
+		}
+
+		Gosu::Color c(argb);
+		rgba4 = rgba4 && fits4(c.alpha()) && fits4(c.red()) &&
+			fits4(c.green()) && fits4(c.blue());
+		rgb5a1 = rgb5a1 && (c.alpha() == 0 || c.alpha() == 255) &&
+			fits5(c.red()) && fits5(c.green()) && fits5(c.blue());
+	}
+
+	// The smallest format that fits, if it beats what Gosu would use.
+	TextureFormat candidates[4];
+	int n = 0;
+	if (paletted && palette.size() <= PALETTE4_COLORS)
+		candidates[n++] = TEX_PALETTE4;
+	if (paletted)
+		candidates[n++] = TEX_PALETTE8;
+	if (rgba4)
+		candidates[n++] = TEX_RGBA4;
+	else if (rgb5a1)
+		candidates[n++] = TEX_RGB5_A1;
+
+	TextureFormat fmt = TEX_RGBA8;
+	size_t best = count * 4;
+	for (int i = 0; i < n; i++) {
+		size_t bytes = formatBytes(candidates[i], texW, texH);
+		if (bytes < best) {
+			fmt = candidates[i];
+			best = bytes;
+		}
+	}
+	if (fmt == TEX_RGBA8)
+		return CompactTextureRef();
+
+	// Whole texture, padding included.
+	std::vector<uint8_t> data(best, 0);
+	if (fmt == TEX_PALETTE4 || fmt == TEX_PALETTE8) {
+		uint8_t* entry = data.data();
+		for (size_t i = 0; i < palette.size(); i++) {
+			Gosu::Color c(palette[i]);
+			entry[0] = c.red();
+			entry[1] = c.green();
+			entry[2] = c.blue();
+			entry[3] = c.alpha();
+			entry += 4;
+		}
+
+		bool packed = fmt == TEX_PALETTE4;
+		uint8_t* out = data.data() + 4 *
+			(packed ? PALETTE4_COLORS : PALETTE8_COLORS);
+		uint32_t lastColor = canonical(pixels[0]);
+		uint8_t lastIndex = indices[lastColor];
+		for (unsigned y = 0; y < h; y++) {
+			const Gosu::Color* row = pixels + (size_t)y * w;
+			for (unsigned x = 0; x < w; x++) {
+				uint32_t argb = canonical(row[x]);
+				if (argb != lastColor) {
+					lastColor = argb;
+					lastIndex = indices[argb];
+				}
+				// Indices run on from row to row. With four
+				// bits, the first of each pair is on top.
+				size_t i = (size_t)y * texW + x;
+				if (!packed)
+					out[i] = lastIndex;
+				else if (i % 2 == 0)
+					out[i / 2] |= (uint8_t)(lastIndex << 4);
+				else
+					out[i / 2] |= lastIndex;
+			}
+		}
+	}
+	else {
+		uint16_t* out = (uint16_t*)data.data();
+		for (unsigned y = 0; y < h; y++) {
+			const Gosu::Color* row = pixels + (size_t)y * w;
+			for (unsigned x = 0; x < w; x++) {
+				Gosu::Color c(canonical(row[x]));
+				uint16_t texel;
+				if (fmt == TEX_RGBA4)
+					texel = (uint16_t)(
+						(c.red() >> 4) << 12 |
+						(c.green() >> 4) << 8 |
+						(c.blue() >> 4) << 4 |
+						c.alpha() >> 4);
+				else
+					texel = (uint16_t)(
+						(c.red() >> 3) << 11 |
+						(c.green() >> 3) << 6 |
+						(c.blue() >> 3) << 1 |
+						c.alpha() >> 7);
+				out[(size_t)y * texW + x] = texel;
+			}
+		}
+	}
+
+	CompactTextureRef texture(new CompactTexture);
+	texture->width = w;
+	texture->height = h;
+	texture->texWidth = texW;
+	texture->texHeight = texH;
+	texture->fmt = fmt;
+	runOnGLThread(std::bind(&CompactTexture::upload, texture.get(),
+	                        (const void*)data.data(), data.size()));
+	if (!texture->name)
+		return CompactTextureRef();
+	return texture;
+}
+
+CompactTexture::CompactTexture()
+	: name(0), width(0), height(0), texWidth(0), texHeight(0),
+	  fmt(TEX_RGBA8)
+{
+}
+
+CompactTexture::~CompactTexture()
+{
+	if (name)
+		runOnGLThread(std::bind(deleteTexture, (GLuint)name));
+}
+
+void CompactTexture::upload(const void* pixels, size_t length)
+{
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Our rows aren't padded.
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	while (glGetError() != GL_NO_ERROR)
+		;
+	GLsizei w = (GLsizei)texWidth, h = (GLsizei)texHeight;
+	switch (fmt) {
+#ifndef _WIN32
+	case TEX_PALETTE4:
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_PALETTE4_RGBA8_OES,
+			w, h, 0, (GLsizei)length, pixels);
+		break;
+	case TEX_PALETTE8:
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_PALETTE8_RGBA8_OES,
+			w, h, 0, (GLsizei)length, pixels);
+		break;
+#endif
+	case TEX_RGBA4:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA4, w, h, 0, GL_RGBA,
+		             GL_UNSIGNED_SHORT_4_4_4_4, pixels);
+		break;
+	case TEX_RGB5_A1:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5_A1, w, h, 0, GL_RGBA,
+		             GL_UNSIGNED_SHORT_5_5_5_1, pixels);
+		break;
+	default:
+		break;
+	}
+	bool ok = glGetError() == GL_NO_ERROR;
+
+	glPopClientAttrib();
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Leave it to Gosu if the driver disagrees.
+	if (ok)
+		name = tex;
+	else
+		glDeleteTextures(1, &tex);
+}
+
+Gosu::Image* CompactTexture::subImage(unsigned x, unsigned y,
+                                      unsigned w, unsigned h)
+{
+	std::unique_ptr<Gosu::ImageData> data(new CompactImageData(
+		shared_from_this(), name, texWidth, texHeight, x, y, w, h));
+	return new Gosu::Image(std::move(data));
+}
+
+TextureFormat CompactTexture::format() const
+{
+	return fmt;
+}
+
+size_t CompactTexture::bytes() const
+{
+	return formatBytes(fmt, texWidth, texHeight);
+}
+
+size_t CompactTexture::fullBytes() const
+{
+	return formatBytes(TEX_RGBA8, width, height);
+}
+
@@ -0,0 +1,93 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-texture.h                     **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef GOSU_TEXTURE_H
+#define GOSU_TEXTURE_H
+
+#include <stddef.h>
+
+#include <memory>
+
+namespace Gosu { class Bitmap; }
+namespace Gosu { class Image; }
+
+//! How a CompactTexture stores its pixels.
+enum TextureFormat {
+	TEX_PALETTE4, //!< Up to 16 colors, 4 bits per pixel.
+	TEX_PALETTE8, //!< Up to 256 colors, 8 bits per pixel.
+	TEX_RGBA4,    //!< 4 bits per channel.
+	TEX_RGB5_A1,  //!< 5 bits per color channel, alpha on or off.
+	TEX_RGBA8     //!< 8 bits per channel. What Gosu uses.
+};
+
+/**
+ * An OpenGL texture holding a whole bitmap in fewer than 32 bits per pixel.
+ * Gosu stores every image as 32-bit RGBA, but pixel art tends to use a
+ * handful of colors, or colors that 16 bits describe exactly.
+ *
+ * Pixels are never approximated. Bitmaps that only fit in 32 bits are left
+ * to Gosu.
+ */
+class CompactTexture : public std::enable_shared_from_this<CompactTexture>
+{
+public:
+	/**
+	 * Upload bitmap in the smallest format that holds it exactly. Returns
+	 * NULL if that would save nothing or the bitmap is too large for one
+	 * texture. Can be called from any thread.
+	 */
+	static std::shared_ptr<CompactTexture> create(const Gosu::Bitmap& bitmap);
+
+	//! Frees the texture from the thread that owns OpenGL.
+	~CompactTexture();
+
+	//! An Image showing part of the texture. RendererImpl batches it like
+	//! any other.
+	Gosu::Image* subImage(unsigned x, unsigned y, unsigned w, unsigned h);
+
+	TextureFormat format() const;
+
+	//! Video memory asked for, in bytes.
+	size_t bytes() const;
+
+	//! What Gosu would have used.
+	size_t fullBytes() const;
+
+private:
+	CompactTexture();
+
+	void upload(const void* pixels, size_t length);
+
+	unsigned name;
+	unsigned width, height; //!< Of the bitmap.
+	unsigned texWidth, texHeight; //!< Rounded up if OpenGL needs it.
+	TextureFormat fmt;
+};
+
+typedef std::shared_ptr<CompactTexture> CompactTextureRef;
+
+#endif
+
@@ -0,0 +1,259 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-thread.cpp                    **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#include <Gosu/Image.hpp>
+
+#include "gosu-renderer.h"
+#include "gosu-thread.h"
+#include "../python.h"
+#include "../window.h"
+
+//! A function waiting to be run on the OpenGL thread.
+struct GLTask {
+	const std::function<void()>* fn;
+	bool done;
+};
+
+static std::thread::id glThread;
+
+// Guards everything below, and SimulationThread's state.
+static std::mutex lock;
+//! Wakes the OpenGL thread for tasks or a finished step.
+static std::condition_variable glWake;
+//! Wakes threads waiting on their GLTask.
+static std::condition_variable taskDone;
+
+static std::deque<GLTask*> tasks;
+static std::vector<Gosu::Image*> released;
+
+void setGLThread()
+{
+	glThread = std::this_thread::get_id();
+}
+
+bool onGLThread()
+{
+	return std::this_thread::get_id() == glThread;
+}
+
+void runOnGLThread(const std::function<void()>& fn)
+{
+	if (onGLThread()) {
+		fn();
+		return;
+	}
+
+	GLTask task = { &fn, false };
+	std::unique_lock<std::mutex> guard(lock);
+	tasks.push_back(&task);
+	glWake.notify_all();
+	while (!task.done)
+		taskDone.wait(guard);
+}
+
+void releaseOnGLThread(Gosu::Image* img)
+{
+	if (onGLThread()) {
+		delete img;
+		return;
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	released.push_back(img);
+}
+
+//! Run queued GLTasks. Called on the OpenGL thread with the lock held.
+static void runTasks(std::unique_lock<std::mutex>& guard)
+{
+	if (tasks.empty())
+		return;
+	while (tasks.size()) {
+		GLTask* task = tasks.front();
+		tasks.pop_front();
+		guard.unlock();
+		(*task->fn)();
+		guard.lock();
+		task->done = true;
+	}
+	taskDone.notify_all();
+}
+
+//! Delete Images released before the last frame swap. The frame now
+//! waiting to be presented was recorded after they were let go, and the
+//! one before it is gone.
+static void deleteReleased()
+{
+	std::vector<Gosu::Image*> imgs;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		imgs.swap(released);
+	}
+	for (size_t i = 0; i < imgs.size(); i++)
+		delete imgs[i];
+}
+
+
+SimulationThread::SimulationThread(GameWindow& game)
+	: game(game),
+	  stepping(false),
+	  quitting(false),
+	  drew(false),
+	  idle(0),
+	  thread(std::bind(&SimulationThread::run, this))
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	quitting = true;
+	work.notify_all();
+	// The last step might still need us.
+	while (stepping) {
+		runTasks(guard);
+		if (stepping)
+			glWake.wait(guard);
+	}
+	guard.unlock();
+	thread.join();
+	deleteReleased();
+}
+
+void SimulationThread::buttonDown(Gosu::Button btn)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Input in = { btn, true };
+	input.push_back(in);
+}
+
+void SimulationThread::buttonUp(Gosu::Button btn)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Input in = { btn, false };
+	input.push_back(in);
+}
+
+bool SimulationThread::isDown(Gosu::Button btn) const
+{
+	return held.find(btn.id()) != held.end();
+}
+
+bool SimulationThread::finish(double maxWait)
+{
+	typedef std::chrono::steady_clock steady;
+	steady::time_point deadline = steady::now() +
+		std::chrono::microseconds((long)(maxWait * 1000.0));
+
+	std::unique_lock<std::mutex> guard(lock);
+	runTasks(guard);
+	while (stepping) {
+		if (glWake.wait_until(guard, deadline) ==
+				std::cv_status::timeout) {
+			runTasks(guard);
+			if (stepping)
+				return false;
+		}
+		runTasks(guard);
+	}
+
+	bool fresh = drew;
+	drew = false;
+	guard.unlock();
+
+	// Until a new frame is up, the old one might be drawn again.
+	if (fresh) {
+		RendererImpl::instance().swapFrames();
+		deleteReleased();
+	}
+	return true;
+}
+
+void SimulationThread::start()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	stepping = true;
+	work.notify_all();
+}
+
+time_t SimulationThread::idleTime() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return idle;
+}
+
+void SimulationThread::run()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		while (!stepping && !quitting)
+			work.wait(guard);
+		if (!stepping)
+			break;
+
+		events.swap(input);
+		guard.unlock();
+		step();
+		guard.lock();
+		events.clear();
+		stepping = false;
+		glWake.notify_all();
+	}
+}
+
+void SimulationThread::step()
+{
+	pythonEnter();
+
+	for (size_t i = 0; i < events.size(); i++) {
+		Gosu::Button btn = events[i].btn;
+		if (events[i].down) {
+			held.insert(btn.id());
+			game.buttonDown(btn);
+		}
+		else {
+			held.erase(btn.id());
+			game.buttonUp(btn);
+		}
+	}
+
+	game.update();
+	bool fresh = game.needsRedraw();
+	if (fresh) {
+		game.draw();
+		RendererImpl::instance().finishFrame();
+	}
+	time_t wait = game.idleTime();
+
+	pythonLeave();
+
+	std::lock_guard<std::mutex> guard(lock);
+	drew = drew || fresh;
+	idle = wait;
+}
+
@@ -0,0 +1,127 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-thread.h                      **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef GOSU_THREAD_H
+#define GOSU_THREAD_H
+
+#include <condition_variable>
+#include <ctime> // for time_t
+#include <functional>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <Gosu/Input.hpp> // for Gosu::Button
+
+namespace Gosu { class Image; }
+
+class GameWindow;
+
+//! Remember the calling thread as the one that owns OpenGL.
+void setGLThread();
+
+//! Is this the thread that owns OpenGL?
+bool onGLThread();
+
+//! Run fn on the thread that owns OpenGL and wait for it. Runs it right
+//! away if called from there.
+void runOnGLThread(const std::function<void()>& fn);
+
+//! Delete img on the thread that owns OpenGL, once no frame waiting to be
+//! presented can still draw it.
+void releaseOnGLThread(Gosu::Image* img);
+
+/**
+ * Runs the game's updates on a thread of their own, so that the thread Gosu
+ * draws from never waits on scripts.
+ *
+ * Each step handles queued input, updates the World and, if anything
+ * changed, records a frame with RendererImpl. While it does, the OpenGL
+ * thread presents the frame from the step before. Anything a step needs
+ * done with OpenGL, like creating a texture, is handed back to the OpenGL
+ * thread through runOnGLThread().
+ *
+ * Only the simulation thread touches Python while this is running.
+ */
+class SimulationThread
+{
+public:
+	SimulationThread(GameWindow& game);
+
+	//! Waits for the step in progress, then stops the thread.
+	~SimulationThread();
+
+	//! Queue input for the next step.
+	void buttonDown(Gosu::Button btn);
+	void buttonUp(Gosu::Button btn);
+
+	//! Is btn held down, going by the input steps have handled so far?
+	//! Only call from the simulation thread.
+	bool isDown(Gosu::Button btn) const;
+
+	/**
+	 * Wait up to maxWait milliseconds for the step in progress, running
+	 * tasks it hands over meanwhile. Returns false if it is still going.
+	 * Otherwise the frame it recorded, if any, is made ready to present.
+	 */
+	bool finish(double maxWait);
+
+	//! Start the next step. Only call after finish() returned true.
+	void start();
+
+	//! GameWindow::idleTime() at the end of the last step.
+	time_t idleTime() const;
+
+private:
+	void run();
+	void step();
+
+	struct Input {
+		Gosu::Button btn;
+		bool down;
+	};
+
+	GameWindow& game;
+
+	std::condition_variable work;
+	bool stepping, quitting;
+
+	std::vector<Input> input; //!< Waiting for the next step.
+	std::vector<Input> events; //!< Being handled by this step.
+
+	//! Ids of buttons held down. Only the simulation thread uses this,
+	//! so the OpenGL thread's Gosu::Input is never read from here.
+	std::set<unsigned> held;
+
+	// Results of the last step.
+	bool drew;
+	time_t idle;
+
+	std::thread thread;
+};
+
+#endif
+
@@ -28,14 +28,16 @@
 
 #include "gosu-cbuffer.h"
 #include "gosu-image.h"
+#include "gosu-opacity.h"
 #include "gosu-tiledimage.h"
 #include "../window.h"
 
-TiledImage* TiledImage::create(void* data, size_t length,
+TiledImage* TiledImage::create(const std::string& name,
+		void* data, size_t length,
 		unsigned tileW, unsigned tileH)
 {
 	TiledImageImpl* tii = new TiledImageImpl;
-	if (tii->init(data, length, tileW, tileH))
+	if (tii->init(name, data, length, tileW, tileH))
 		return tii;
 	else {
 		delete tii;
@@ -44,18 +46,28 @@ TiledImage* TiledImage::create(void* data, size_t length,
 }
 
 
-bool TiledImageImpl::init(void* data, size_t length, unsigned tileW, unsigned tileH)
+bool TiledImageImpl::init(const std::string& name, void* data, size_t length,
+                          unsigned tileW, unsigned tileH)
 {
 	Gosu::CBuffer buffer(data, length);
-	Gosu::Bitmap bitmap;
+	BitmapRef bitmap(new Gosu::Bitmap);
 
-	Gosu::loadImageFile(bitmap, buffer.frontReader());
+	Gosu::loadImageFile(*bitmap, buffer.frontReader());
 
-	for (unsigned y = 0; y < bitmap.height(); y += tileH) {
-		for (unsigned x = 0; x < bitmap.width(); x += tileW) {
+	group.reset(new ResidencyGroup(name, bitmap));
+
+	// Partial tiles at the right and bottom edges are left out, as Tiled
+	// leaves them out when it numbers a tileset's tiles.
+	for (unsigned y = 0; y + tileH <= bitmap->height(); y += tileH) {
+		for (unsigned x = 0; x + tileW <= bitmap->width(); x += tileW) {
 			ImageImpl* img = new ImageImpl;
-			if (img->init(bitmap, x, y, tileW, tileH))
+			if (img->init(bitmap, group, x, y, tileW, tileH)) {
+				// Lets Areas skip drawing empty tiles and
+				// tiles covered by opaque ones.
+				img->setOpacity(bitmapOpacity(*bitmap,
+					x, y, tileW, tileH));
 				vec.push_back(ImageRef(img));
+			}
 			else {
 				delete img;
 				return false;
@@ -63,6 +75,7 @@ bool TiledImageImpl::init(void* data, size_t length, unsigned tileW, unsigned ti
 		}
 	}
 
+	group->queueUpload();
 	return true;
 }
 
@@ -83,3 +96,13 @@ const ImageRef& TiledImageImpl::operator[](size_t n) const
 	return vec[n];
 }
 
+void TiledImageImpl::pin()
+{
+	group->pin();
+}
+
+void TiledImageImpl::unpin()
+{
+	group->unpin();
+}
+
@@ -27,22 +27,29 @@
 #ifndef GOSU_TILEDIMAGE_H
 #define GOSU_TILEDIMAGE_H
 
+#include <string>
 #include <vector>
 
+#include "gosu-residency.h"
 #include "../tiledimage.h"
 
 class TiledImageImpl : public TiledImage
 {
 public:
-	bool init(void* data, size_t length, unsigned tileW, unsigned tileH);
+	bool init(const std::string& name, void* data, size_t length,
+	          unsigned tileW, unsigned tileH);
 
 	size_t size() const;
 
 	ImageRef& operator[](size_t n);
 	const ImageRef& operator[](size_t n) const;
 
+	void pin();
+	void unpin();
+
 private:
 	std::vector<ImageRef> vec;
+	ResidencyGroupRef group;
 };
 
 #endif
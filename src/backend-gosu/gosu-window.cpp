@@ -0,0 +1,257 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-window.cpp                    **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <algorithm>
+
+#include <Gosu/Graphics.hpp> // for Gosu::Graphics
+#include <Gosu/Timing.hpp>
+#include <Gosu/Utility.hpp>
+#include <Gosu/Window.hpp>
+
+#include "gosu-renderer.h"
+#include "gosu-thread.h"
+#include "gosu-window.h"
+#include "../client-conf.h"
+#include "../python.h"
+
+namespace Gosu {
+	/**
+	 * Enable 1980s-style graphics scaling: nearest-neighbor filtering.
+	 * Call this function before creating any Gosu::Image.
+	 */
+	void enableUndocumentedRetrofication() {
+		extern bool undocumentedRetrofication;
+		undocumentedRetrofication = true;
+	}
+}
+
+/**
+ * Hands Gosu's callbacks to the GameWindow.
+ */
+class GosuWindow : public Gosu::Window
+{
+public:
+	GosuWindow(GameWindow& game);
+
+	//! Show the window until it is closed.
+	void run();
+
+	void buttonDown(const Gosu::Button btn);
+	void buttonUp(const Gosu::Button btn);
+	bool isDown(const Gosu::Button btn) const;
+	void draw();
+	bool needsRedraw() const;
+	void update();
+
+private:
+	//! Sleep while the game is idle. See GameWindow::idleTime().
+	void nap(time_t idle);
+
+	GameWindow& game;
+
+	//! Runs updates while we draw, if [engine] renderthread is set.
+	std::unique_ptr<SimulationThread> sim;
+};
+
+GosuWindow::GosuWindow(GameWindow& game)
+	// Gosu emulates the requested screen resolution on fullscreen,
+	// but this breaks our aspect ratio-correcting letterbox.
+	// Ergo we just make a window the size of the screen.
+	: Gosu::Window(
+	    conf.fullscreen ? Gosu::screenWidth() :
+	                      (unsigned)conf.windowSize.x,
+	    conf.fullscreen ? Gosu::screenHeight() :
+	                      (unsigned)conf.windowSize.y,
+	    conf.fullscreen
+	  ),
+	  game(game)
+{
+}
+
+void GosuWindow::run()
+{
+	if (conf.renderThread) {
+		pythonHandOff();
+		sim.reset(new SimulationThread(game));
+	}
+	show();
+	if (sim) {
+		sim.reset();
+		pythonReclaim();
+	}
+}
+
+void GosuWindow::buttonDown(const Gosu::Button btn)
+{
+	if (sim)
+		sim->buttonDown(btn);
+	else
+		game.buttonDown(btn);
+}
+
+void GosuWindow::buttonUp(const Gosu::Button btn)
+{
+	if (sim)
+		sim->buttonUp(btn);
+	else
+		game.buttonUp(btn);
+}
+
+bool GosuWindow::isDown(const Gosu::Button btn) const
+{
+	// Gosu::Input belongs to the OpenGL thread.
+	if (sim)
+		return sim->isDown(btn);
+	return input().down(btn);
+}
+
+void GosuWindow::draw()
+{
+	RendererImpl& renderer = RendererImpl::instance();
+	if (!sim) {
+		game.draw();
+		renderer.swapFrames();
+	}
+	renderer.present();
+}
+
+bool GosuWindow::needsRedraw() const
+{
+	if (sim)
+		return RendererImpl::instance().framePending();
+	return game.needsRedraw();
+}
+
+void GosuWindow::update()
+{
+	if (!sim) {
+		game.update();
+		nap(game.idleTime());
+		return;
+	}
+
+	// A slow step is left running, and the last frame stays up.
+	if (!sim->finish(updateInterval()))
+		return;
+	nap(sim->idleTime());
+	sim->start();
+}
+
+void GosuWindow::nap(time_t idle)
+{
+	// Gosu can't wait on input, so nap in slices short enough that a key
+	// press is still noticed promptly. Gosu's own pacing covers the last
+	// update interval.
+	idle = std::min(idle, (time_t)conf.idleSleep);
+	if (idle > (time_t)updateInterval())
+		Gosu::sleep((unsigned)(idle - (time_t)updateInterval()));
+}
+
+
+GameWindow* GameWindow::create()
+{
+	return new GameWindowImpl;
+}
+
+GameWindowImpl& GameWindowImpl::instance()
+{
+	return static_cast<GameWindowImpl&>(GameWindow::instance());
+}
+
+GameWindowImpl::GameWindowImpl()
+	: window(new GosuWindow(*this))
+{
+	setGLThread();
+	now = readClock();
+	Gosu::enableUndocumentedRetrofication();
+}
+
+GameWindowImpl::~GameWindowImpl()
+{
+}
+
+int GameWindowImpl::width() const
+{
+	return (int)window->graphics().width();
+}
+
+int GameWindowImpl::height() const
+{
+	return (int)window->graphics().height();
+}
+
+void GameWindowImpl::setCaption(const std::string& caption)
+{
+	window->setCaption(Gosu::widen(caption));
+}
+
+void GameWindowImpl::mainLoop()
+{
+	window->run();
+}
+
+bool GameWindowImpl::isDown(Gosu::Button btn) const
+{
+	return window->isDown(btn);
+}
+
+void GameWindowImpl::drawRect(double x1, double x2, double y1, double y2,
+                              Gosu::Color c, double z)
+{
+	RendererImpl::instance().drawRect(x1, x2, y1, y2, c, z);
+}
+
+void GameWindowImpl::pushClip(double x, double y, double w, double h)
+{
+	RendererImpl::instance().pushClip(x, y, w, h);
+}
+
+void GameWindowImpl::popClip()
+{
+	RendererImpl::instance().popClip();
+}
+
+void GameWindowImpl::pushTransform(const Gosu::Transform& t)
+{
+	RendererImpl::instance().pushTransform(t);
+}
+
+void GameWindowImpl::popTransform()
+{
+	RendererImpl::instance().popTransform();
+}
+
+Gosu::Graphics& GameWindowImpl::graphics()
+{
+	return window->graphics();
+}
+
+time_t GameWindowImpl::readClock() const
+{
+	return (time_t)Gosu::milliseconds();
+}
+
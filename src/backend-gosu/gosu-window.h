@@ -0,0 +1,76 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** gosu-window.h                      **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef GOSU_WINDOW_H
+#define GOSU_WINDOW_H
+
+#include <memory>
+
+#include "../window.h"
+
+namespace Gosu { class Graphics; }
+
+class GosuWindow;
+
+class GameWindowImpl : public GameWindow
+{
+public:
+	static GameWindowImpl& instance();
+
+	GameWindowImpl();
+	~GameWindowImpl();
+
+	int width() const;
+	int height() const;
+
+	void setCaption(const std::string& caption);
+
+	void mainLoop();
+
+	bool isDown(Gosu::Button btn) const;
+
+	void drawRect(double x1, double x2, double y1, double y2,
+	              Gosu::Color c, double z);
+
+	void pushClip(double x, double y, double w, double h);
+	void popClip();
+
+	void pushTransform(const Gosu::Transform& t);
+	void popTransform();
+
+	Gosu::Graphics& graphics();
+
+protected:
+	time_t readClock() const;
+
+private:
+	//! The Gosu::Window we forward callbacks from.
+	std::unique_ptr<GosuWindow> window;
+};
+
+#endif
+
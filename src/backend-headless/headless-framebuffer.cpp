@@ -0,0 +1,326 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-framebuffer.cpp           **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_TARGET
+#endif
+
+#include <Gosu/Utility.hpp>
+
+#include "headless-framebuffer.h"
+
+/*
+ * Blending math
+ *
+ * Pixels are 32-bit words with alpha in the top byte. That holds for both
+ * channel orders Gosu has used, and the order of the other three channels
+ * does not matter because every channel is blended the same way:
+ *
+ *   out = (src * a + dst * (255 - a)) / 255
+ *
+ * The destination is always opaque, so its alpha is simply forced back to
+ * 255 afterwards. Division by 255 is done exactly with the usual
+ * t = x + 128; (t + (t >> 8)) >> 8, which fits in 16 bits for every input.
+ */
+
+#define ALPHA_MASK 0xFF000000u
+
+static inline uint32_t blendPixel(uint32_t s, uint32_t d)
+{
+	uint32_t a = s >> 24;
+	if (a == 255)
+		return s;
+	if (a == 0)
+		return d;
+
+	uint32_t out = ALPHA_MASK;
+	for (int shift = 0; shift < 24; shift += 8) {
+		uint32_t sc = (s >> shift) & 0xFF;
+		uint32_t dc = (d >> shift) & 0xFF;
+		uint32_t t = sc * a + dc * (255 - a) + 128;
+		out |= ((t + (t >> 8)) >> 8) << shift;
+	}
+	return out;
+}
+
+static void blendRowScalar(uint32_t* dst, const uint32_t* src, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		dst[i] = blendPixel(src[i], dst[i]);
+}
+
+#if defined(__SSE2__)
+//! Blend 8 16-bit channels (two pixels) of s onto d.
+static inline __m128i blend2(__m128i s, __m128i d)
+{
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c128 = _mm_set1_epi16(128);
+
+	// Broadcast each pixel's alpha across its four channels.
+	__m128i a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(s, a),
+		_mm_mullo_epi16(d, _mm_sub_epi16(c255, a)));
+	t = _mm_add_epi16(t, c128);
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void blendRowSSE2(uint32_t* dst, const uint32_t* src, size_t n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32((int)ALPHA_MASK);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+		__m128i lo = blend2(_mm_unpacklo_epi8(s, zero),
+		                    _mm_unpacklo_epi8(d, zero));
+		__m128i hi = blend2(_mm_unpackhi_epi8(s, zero),
+		                    _mm_unpackhi_epi8(d, zero));
+		__m128i out = _mm_or_si128(_mm_packus_epi16(lo, hi), alpha);
+		_mm_storeu_si128((__m128i*)(dst + i), out);
+	}
+	blendRowScalar(dst + i, src + i, n - i);
+}
+#endif
+
+#ifdef HAVE_AVX2_TARGET
+__attribute__((target("avx2")))
+static void blendRowAVX2(uint32_t* dst, const uint32_t* src, size_t n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const __m256i alpha = _mm256_set1_epi32((int)ALPHA_MASK);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+
+		// Unpacking and packing both work within 128-bit lanes, so
+		// pixels come back out in the order they went in.
+		__m256i sh[2] = {
+			_mm256_unpacklo_epi8(s, zero),
+			_mm256_unpackhi_epi8(s, zero)
+		};
+		__m256i dh[2] = {
+			_mm256_unpacklo_epi8(d, zero),
+			_mm256_unpackhi_epi8(d, zero)
+		};
+		for (int h = 0; h < 2; h++) {
+			__m256i a = _mm256_shufflelo_epi16(sh[h],
+				_MM_SHUFFLE(3, 3, 3, 3));
+			a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+			__m256i t = _mm256_add_epi16(
+				_mm256_mullo_epi16(sh[h], a),
+				_mm256_mullo_epi16(dh[h],
+					_mm256_sub_epi16(c255, a)));
+			t = _mm256_add_epi16(t, c128);
+			sh[h] = _mm256_srli_epi16(_mm256_add_epi16(t,
+				_mm256_srli_epi16(t, 8)), 8);
+		}
+		__m256i out = _mm256_or_si256(
+			_mm256_packus_epi16(sh[0], sh[1]), alpha);
+		_mm256_storeu_si256((__m256i*)(dst + i), out);
+	}
+	blendRowScalar(dst + i, src + i, n - i);
+}
+#endif
+
+typedef void (*BlendRow)(uint32_t* dst, const uint32_t* src, size_t n);
+
+//! Pick the widest blend routine this CPU runs.
+static BlendRow chooseBlendRow()
+{
+#ifdef HAVE_AVX2_TARGET
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return blendRowAVX2;
+#endif
+#if defined(__SSE2__)
+	return blendRowSSE2;
+#else
+	return blendRowScalar;
+#endif
+}
+
+static const BlendRow blendRow = chooseBlendRow();
+
+//! The 32-bit word a Color is stored as inside a Bitmap.
+static uint32_t pixelOf(Gosu::Color c)
+{
+	uint32_t word;
+	memcpy(&word, &c, sizeof(word));
+	return word;
+}
+
+
+Framebuffer::Framebuffer(unsigned width, unsigned height)
+	: pixels(width, height, Gosu::Color::BLACK),
+	  scratch(width), columns(width)
+{
+}
+
+unsigned Framebuffer::width() const
+{
+	return pixels.width();
+}
+
+unsigned Framebuffer::height() const
+{
+	return pixels.height();
+}
+
+Framebuffer::Rect Framebuffer::bounds() const
+{
+	Rect r = { 0, 0, (int)width(), (int)height() };
+	return r;
+}
+
+void Framebuffer::clear(Gosu::Color c)
+{
+	uint32_t word = pixelOf(c) | ALPHA_MASK;
+	uint32_t* p = row(0);
+	std::fill(p, p + width() * height(), word);
+}
+
+void Framebuffer::span(double start, double length, int lo, int hi,
+                       int* first, int* last)
+{
+	// A pixel is covered when its center is.
+	*first = std::max(lo, (int)ceil(start - 0.5));
+	*last = std::min(hi, (int)ceil(start + length - 0.5));
+}
+
+uint32_t* Framebuffer::row(int y)
+{
+	return reinterpret_cast<uint32_t*>(pixels.data()) +
+		(size_t)y * width();
+}
+
+void Framebuffer::blit(const Gosu::Bitmap& src, const Rect& srcRect,
+                       double dstX, double dstY, double scaleX, double scaleY,
+                       const Rect& clip)
+{
+	int srcW = srcRect.x2 - srcRect.x1;
+	int srcH = srcRect.y2 - srcRect.y1;
+	if (srcW <= 0 || srcH <= 0 || scaleX <= 0 || scaleY <= 0)
+		return;
+
+	Rect r = bounds();
+	r.x1 = std::max(r.x1, clip.x1);
+	r.y1 = std::max(r.y1, clip.y1);
+	r.x2 = std::min(r.x2, clip.x2);
+	r.y2 = std::min(r.y2, clip.y2);
+
+	int x1, x2, y1, y2;
+	span(dstX, srcW * scaleX, r.x1, r.x2, &x1, &x2);
+	span(dstY, srcH * scaleY, r.y1, r.y2, &y1, &y2);
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	const uint32_t* srcPixels =
+		reinterpret_cast<const uint32_t*>(src.data());
+	size_t n = (size_t)(x2 - x1);
+	bool unscaled = scaleX == 1.0 && dstX == floor(dstX);
+
+	// Nearest-neighbor: the source column under each pixel's center.
+	if (!unscaled) {
+		for (int x = x1; x < x2; x++) {
+			int sx = (int)((x + 0.5 - dstX) / scaleX);
+			sx = std::min(std::max(sx, 0), srcW - 1);
+			columns[x - x1] = (unsigned)(srcRect.x1 + sx);
+		}
+	}
+
+	for (int y = y1; y < y2; y++) {
+		int sy = (int)((y + 0.5 - dstY) / scaleY);
+		sy = std::min(std::max(sy, 0), srcH - 1);
+		const uint32_t* line = srcPixels +
+			(size_t)(srcRect.y1 + sy) * src.width();
+
+		const uint32_t* s;
+		if (unscaled)
+			s = line + srcRect.x1 + (x1 - (int)dstX);
+		else {
+			for (size_t i = 0; i < n; i++)
+				scratch[i] = line[columns[i]];
+			s = &scratch[0];
+		}
+		blendRow(row(y) + x1, s, n);
+	}
+}
+
+void Framebuffer::fill(double x1, double y1, double x2, double y2,
+                       Gosu::Color c, const Rect& clip)
+{
+	if (c.alpha() == 0)
+		return;
+
+	Rect r = bounds();
+	r.x1 = std::max(r.x1, clip.x1);
+	r.y1 = std::max(r.y1, clip.y1);
+	r.x2 = std::min(r.x2, clip.x2);
+	r.y2 = std::min(r.y2, clip.y2);
+
+	int px1, px2, py1, py2;
+	span(std::min(x1, x2), fabs(x2 - x1), r.x1, r.x2, &px1, &px2);
+	span(std::min(y1, y2), fabs(y2 - y1), r.y1, r.y2, &py1, &py2);
+	if (px1 >= px2 || py1 >= py2)
+		return;
+
+	size_t n = (size_t)(px2 - px1);
+	std::fill(scratch.begin(), scratch.begin() + (long)n, pixelOf(c));
+	for (int y = py1; y < py2; y++)
+		blendRow(row(y) + px1, &scratch[0], n);
+}
+
+bool Framebuffer::save(const std::string& filename) const
+{
+	try {
+		Gosu::saveImageFile(pixels, Gosu::widen(filename));
+	}
+	catch (std::exception&) {
+		return false;
+	}
+	return true;
+}
+
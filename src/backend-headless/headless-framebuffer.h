@@ -0,0 +1,96 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-framebuffer.h             **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef HEADLESS_FRAMEBUFFER_H
+#define HEADLESS_FRAMEBUFFER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <Gosu/Bitmap.hpp>
+
+/**
+ * An opaque image in main memory that Bitmaps can be alpha blended onto.
+ * Blending uses SSE2, or AVX2 when the CPU has it.
+ */
+class Framebuffer
+{
+public:
+	//! Pixel rectangle. x2 and y2 are exclusive.
+	struct Rect {
+		int x1, y1, x2, y2;
+	};
+
+	Framebuffer(unsigned width, unsigned height);
+
+	unsigned width() const;
+	unsigned height() const;
+
+	//! The whole framebuffer, for clipping against.
+	Rect bounds() const;
+
+	void clear(Gosu::Color c);
+
+	/**
+	 * Blend part of a Bitmap onto the framebuffer, scaled with
+	 * nearest-neighbor filtering.
+	 *
+	 * @param src     source pixels
+	 * @param srcRect part of src to draw
+	 * @param dstX    position of the upper-left corner on the framebuffer
+	 * @param scaleX  horizontal scale factor, must be positive
+	 * @param clip    only pixels inside this rectangle are touched
+	 */
+	void blit(const Gosu::Bitmap& src, const Rect& srcRect,
+	          double dstX, double dstY, double scaleX, double scaleY,
+	          const Rect& clip);
+
+	//! Blend a solid color over a rectangle.
+	void fill(double x1, double y1, double x2, double y2, Gosu::Color c,
+	          const Rect& clip);
+
+	//! Write out as a PNG.
+	bool save(const std::string& filename) const;
+
+private:
+	//! Find the pixels covered by [start, start+length) along one axis.
+	static void span(double start, double length, int lo, int hi,
+	                 int* first, int* last);
+
+	uint32_t* row(int y);
+
+	Gosu::Bitmap pixels;
+
+	//! Source pixels of the row being blended, after scaling.
+	std::vector<uint32_t> scratch;
+	std::vector<unsigned> columns;
+};
+
+#endif
+
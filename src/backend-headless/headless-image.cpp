@@ -0,0 +1,134 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-image.cpp                 **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <cassert>
+
+#include <Gosu/Bitmap.hpp>
+
+#include "headless-image.h"
+#include "headless-renderer.h"
+#include "../backend-gosu/gosu-cbuffer.h"
+
+
+Image* Image::create(const std::string&, void* data, size_t length)
+{
+	ImageImpl* ii = new ImageImpl;
+	if (ii->init(data, length))
+		return ii;
+	else {
+		delete ii;
+		return NULL;
+	}
+}
+
+
+ImageImpl::ImageImpl()
+	: srcX(0), srcY(0), w(0), h(0), coverage(IMAGE_MIXED)
+{
+}
+
+bool ImageImpl::init(void* data, size_t length)
+{
+	assert(!source);
+
+	Gosu::CBuffer buffer(data, length);
+	BitmapRef bitmap(new Gosu::Bitmap);
+
+	Gosu::loadImageFile(*bitmap, buffer.frontReader());
+	return init(bitmap, 0, 0, bitmap->width(), bitmap->height());
+}
+
+bool ImageImpl::init(const BitmapRef& bitmap, unsigned x, unsigned y,
+				unsigned w, unsigned h)
+{
+	assert(!source);
+
+	source = bitmap;
+	srcX = x;
+	srcY = y;
+	this->w = w;
+	this->h = h;
+	return true;
+}
+
+
+void ImageImpl::draw(double dstX, double dstY, double z) const
+{
+	assert(source);
+
+	RendererImpl::instance().draw(*this, dstX, dstY, z);
+}
+
+void ImageImpl::drawSubrect(double dstX, double dstY, double z,
+		 double, double, double, double)
+{
+	draw(dstX, dstY, z);
+}
+
+
+unsigned ImageImpl::width() const
+{
+	return w;
+}
+
+unsigned ImageImpl::height() const
+{
+	return h;
+}
+
+ImageOpacity ImageImpl::opacity() const
+{
+	return coverage;
+}
+
+void ImageImpl::setOpacity(ImageOpacity opacity)
+{
+	coverage = opacity;
+}
+
+void ImageImpl::copyTo(Gosu::Bitmap& dst, unsigned dstX, unsigned dstY) const
+{
+	assert(source);
+
+	dst.insert(*source, (int)dstX, (int)dstY, srcX, srcY, w, h);
+}
+
+const Gosu::Bitmap& ImageImpl::bitmap() const
+{
+	return *source;
+}
+
+unsigned ImageImpl::bitmapX() const
+{
+	return srcX;
+}
+
+unsigned ImageImpl::bitmapY() const
+{
+	return srcY;
+}
+
@@ -0,0 +1,81 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-image.h                   **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef HEADLESS_IMAGE_H
+#define HEADLESS_IMAGE_H
+
+#include <memory>
+
+#include "../image.h"
+
+namespace Gosu { class Bitmap; }
+
+typedef std::shared_ptr<Gosu::Bitmap> BitmapRef;
+
+/**
+ * An Image that only lives in main memory. Drawing it hands it to the
+ * RendererImpl, which counts it and may composite it in software.
+ */
+class ImageImpl : public Image
+{
+public:
+	ImageImpl();
+
+	bool init(void* data, size_t length);
+	bool init(const BitmapRef& bitmap, unsigned x, unsigned y,
+	                                   unsigned w, unsigned h);
+
+	void draw(double dstX, double dstY, double z) const;
+	void drawSubrect(double dstX, double dstY, double z,
+	                 double srcX, double srcY,
+	                 double srcW, double srcH);
+
+	unsigned width() const;
+	unsigned height() const;
+
+	ImageOpacity opacity() const;
+	void setOpacity(ImageOpacity opacity);
+
+	//! Copy our pixels into dst. Used by CanvasImpl. Thread-safe.
+	void copyTo(Gosu::Bitmap& dst, unsigned dstX, unsigned dstY) const;
+
+	//! The bitmap our pixels are in and where in it they start.
+	const Gosu::Bitmap& bitmap() const;
+	unsigned bitmapX() const;
+	unsigned bitmapY() const;
+
+private:
+	//! Decoded pixels. May be shared with other images cut from the same
+	//! bitmap.
+	BitmapRef source;
+	unsigned srcX, srcY, w, h;
+
+	ImageOpacity coverage;
+};
+
+#endif
+
@@ -0,0 +1,225 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-renderer.cpp              **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "headless-image.h"
+#include "headless-renderer.h"
+
+Renderer& Renderer::instance()
+{
+	return RendererImpl::instance();
+}
+
+RendererImpl& RendererImpl::instance()
+{
+	static RendererImpl globalRenderer;
+	return globalRenderer;
+}
+
+RendererImpl::RendererImpl()
+	: totalDraws(0), totalRects(0), totalFrames(0)
+{
+	Transform identity = { 1.0, 1.0, 0.0, 0.0 };
+	transforms.push_back(identity);
+}
+
+void RendererImpl::beginFrame()
+{
+	totalFrames++;
+	ops.clear();
+}
+
+void RendererImpl::barrier()
+{
+	// Ops are composited in a stable depth order, which is already the
+	// order a barrier asks for.
+}
+
+bool RendererImpl::beginOffscreen(double, double, unsigned, unsigned)
+{
+	return false;
+}
+
+void RendererImpl::endOffscreen()
+{
+}
+
+bool RendererImpl::setDamage(const std::vector<DamageRect>&)
+{
+	return false;
+}
+
+void RendererImpl::enableFramebuffer(unsigned width, unsigned height)
+{
+	framebuffer.reset(new Framebuffer(width, height));
+	clips.clear();
+	clips.push_back(framebuffer->bounds());
+}
+
+void RendererImpl::draw(const ImageImpl& img, double x, double y, double z)
+{
+	totalDraws++;
+	if (!framebuffer)
+		return;
+
+	const Transform& t = transforms.back();
+	DrawOp op;
+	op.img = &img;
+	op.x = x * t.sx + t.tx;
+	op.y = y * t.sy + t.ty;
+	op.w = t.sx;
+	op.h = t.sy;
+	op.z = z;
+	op.color = Gosu::Color::WHITE;
+	record(op);
+}
+
+void RendererImpl::drawRect(double x1, double x2, double y1, double y2,
+                            Gosu::Color c, double z)
+{
+	totalRects++;
+	if (!framebuffer)
+		return;
+
+	const Transform& t = transforms.back();
+	DrawOp op;
+	op.img = NULL;
+	op.x = x1 * t.sx + t.tx;
+	op.y = y1 * t.sy + t.ty;
+	op.w = (x2 - x1) * t.sx;
+	op.h = (y2 - y1) * t.sy;
+	op.z = z;
+	op.color = c;
+	record(op);
+}
+
+void RendererImpl::record(const DrawOp& op)
+{
+	ops.push_back(op);
+	ops.back().clip = clips.back();
+}
+
+void RendererImpl::pushClip(double x, double y, double w, double h)
+{
+	if (!framebuffer)
+		return;
+
+	const Transform& t = transforms.back();
+	double x1 = x * t.sx + t.tx, x2 = (x + w) * t.sx + t.tx;
+	double y1 = y * t.sy + t.ty, y2 = (y + h) * t.sy + t.ty;
+
+	const Framebuffer::Rect& outer = clips.back();
+	Framebuffer::Rect r;
+	r.x1 = std::max(outer.x1, (int)floor(std::min(x1, x2) + 0.5));
+	r.y1 = std::max(outer.y1, (int)floor(std::min(y1, y2) + 0.5));
+	r.x2 = std::min(outer.x2, (int)floor(std::max(x1, x2) + 0.5));
+	r.y2 = std::min(outer.y2, (int)floor(std::max(y1, y2) + 0.5));
+	clips.push_back(r);
+}
+
+void RendererImpl::popClip()
+{
+	if (clips.size() > 1)
+		clips.pop_back();
+}
+
+void RendererImpl::pushTransform(const Gosu::Transform& m)
+{
+	// The matrix is column-major. Like Gosu, the new transform is applied
+	// first and the enclosing one after it.
+	const Transform& p = transforms.back();
+	Transform t;
+	t.sx = m[0] * p.sx;
+	t.sy = m[5] * p.sy;
+	t.tx = m[12] * p.sx + p.tx;
+	t.ty = m[13] * p.sy + p.ty;
+	transforms.push_back(t);
+}
+
+void RendererImpl::popTransform()
+{
+	if (transforms.size() > 1)
+		transforms.pop_back();
+}
+
+bool RendererImpl::DepthOrder::operator()(const DrawOp& a,
+                                          const DrawOp& b) const
+{
+	return a.z < b.z;
+}
+
+void RendererImpl::endFrame()
+{
+	if (!framebuffer)
+		return;
+
+	std::stable_sort(ops.begin(), ops.end(), DepthOrder());
+
+	framebuffer->clear(Gosu::Color::BLACK);
+	for (std::vector<DrawOp>::const_iterator it = ops.begin();
+			it != ops.end(); it++) {
+		const DrawOp& op = *it;
+		if (op.img) {
+			Framebuffer::Rect src;
+			src.x1 = (int)op.img->bitmapX();
+			src.y1 = (int)op.img->bitmapY();
+			src.x2 = src.x1 + (int)op.img->width();
+			src.y2 = src.y1 + (int)op.img->height();
+			framebuffer->blit(op.img->bitmap(), src,
+				op.x, op.y, op.w, op.h, op.clip);
+		}
+		else {
+			framebuffer->fill(op.x, op.y, op.x + op.w, op.y + op.h,
+				op.color, op.clip);
+		}
+	}
+	ops.clear();
+}
+
+bool RendererImpl::saveFrame(const std::string& filename) const
+{
+	return framebuffer && framebuffer->save(filename);
+}
+
+unsigned long RendererImpl::draws() const
+{
+	return totalDraws;
+}
+
+unsigned long RendererImpl::rects() const
+{
+	return totalRects;
+}
+
+unsigned long RendererImpl::frames() const
+{
+	return totalFrames;
+}
+
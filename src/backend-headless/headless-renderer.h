@@ -0,0 +1,123 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-renderer.h                **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef HEADLESS_RENDERER_H
+#define HEADLESS_RENDERER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Gosu/Color.hpp>
+#include <Gosu/GraphicsBase.hpp>
+
+#include "headless-framebuffer.h"
+#include "../renderer.h"
+
+class ImageImpl;
+
+/**
+ * Counts draws. When a framebuffer has been enabled the draws are also
+ * recorded and, at the end of each frame, composited in software in the
+ * order Gosu would have drawn them.
+ */
+class RendererImpl : public Renderer
+{
+public:
+	static RendererImpl& instance();
+
+	RendererImpl();
+
+	void beginFrame();
+	void barrier();
+
+	//! Not supported. Draws always go straight to the framebuffer.
+	bool beginOffscreen(double x, double y, unsigned w, unsigned h);
+	void endOffscreen();
+	bool setDamage(const std::vector<DamageRect>& rects);
+
+	//! Start compositing frames at the given resolution.
+	void enableFramebuffer(unsigned width, unsigned height);
+
+	void draw(const ImageImpl& img, double x, double y, double z);
+	void drawRect(double x1, double x2, double y1, double y2,
+	              Gosu::Color c, double z);
+
+	void pushClip(double x, double y, double w, double h);
+	void popClip();
+
+	//! Only the scale and translation parts of t are honored.
+	void pushTransform(const Gosu::Transform& t);
+	void popTransform();
+
+	//! Composite everything drawn since beginFrame().
+	void endFrame();
+
+	//! Save the last composited frame as a PNG.
+	bool saveFrame(const std::string& filename) const;
+
+	//! Images drawn since the program started.
+	unsigned long draws() const;
+
+	//! Rectangles drawn since the program started.
+	unsigned long rects() const;
+
+	//! Frames begun since the program started.
+	unsigned long frames() const;
+
+private:
+	struct Transform {
+		double sx, sy, tx, ty;
+	};
+
+	struct DrawOp {
+		const ImageImpl* img; //!< NULL for a rectangle.
+		double x, y, w, h; //!< In screen pixels.
+		double z;
+		Gosu::Color color;
+		Framebuffer::Rect clip;
+	};
+
+	//! Sorts by depth, ties broken by submission order.
+	struct DepthOrder {
+		bool operator()(const DrawOp& a, const DrawOp& b) const;
+	};
+
+	void record(const DrawOp& op);
+
+	std::unique_ptr<Framebuffer> framebuffer;
+	std::vector<DrawOp> ops;
+	std::vector<Transform> transforms;
+	std::vector<Framebuffer::Rect> clips;
+
+	unsigned long totalDraws;
+	unsigned long totalRects;
+	unsigned long totalFrames;
+};
+
+#endif
+
@@ -0,0 +1,55 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-tiledimage.h              **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef HEADLESS_TILEDIMAGE_H
+#define HEADLESS_TILEDIMAGE_H
+
+#include <string>
+#include <vector>
+
+#include "../tiledimage.h"
+
+class TiledImageImpl : public TiledImage
+{
+public:
+	bool init(const std::string& name, void* data, size_t length,
+	          unsigned tileW, unsigned tileH);
+
+	size_t size() const;
+
+	ImageRef& operator[](size_t n);
+	const ImageRef& operator[](size_t n) const;
+
+	//! Does nothing.
+	void pin();
+	void unpin();
+
+private:
+	std::vector<ImageRef> vec;
+};
+
+#endif
+
@@ -0,0 +1,158 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** headless-window.cpp                **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include "headless-renderer.h"
+#include "headless-window.h"
+#include "../client-conf.h"
+#include "../formatter.h"
+#include "../log.h"
+
+GameWindow* GameWindow::create()
+{
+	return new GameWindowImpl;
+}
+
+GameWindowImpl::GameWindowImpl()
+	: clock(0), updates(0), redraws(0), idles(0),
+	  updateTime(0), drawTime(0)
+{
+	now = readClock();
+
+	if (conf.headlessRender || !conf.headlessScreenshot.empty())
+		RendererImpl::instance().enableFramebuffer(
+			(unsigned)width(), (unsigned)height());
+
+	// There is nothing to play sounds on. With audio off no samples or
+	// songs are decoded, and scripts that play them get nothing back.
+	conf.audioEnabled = false;
+}
+
+int GameWindowImpl::width() const
+{
+	return conf.windowSize.x;
+}
+
+int GameWindowImpl::height() const
+{
+	return conf.windowSize.y;
+}
+
+void GameWindowImpl::setCaption(const std::string& caption)
+{
+	Log::info("Headless", "world: " + caption);
+}
+
+void GameWindowImpl::mainLoop()
+{
+	for (int i = 0; i < conf.headlessFrames; i++) {
+		clock += conf.headlessFrameTime;
+
+		steady::time_point start = steady::now();
+		update();
+		steady::time_point updated = steady::now();
+		updateTime += updated - start;
+		updates++;
+		if (idleTime() >= (time_t)conf.headlessFrameTime)
+			idles++;
+
+		if (needsRedraw()) {
+			draw();
+			RendererImpl::instance().endFrame();
+			drawTime += steady::now() - updated;
+			redraws++;
+		}
+	}
+	report();
+
+	const std::string& shot = conf.headlessScreenshot;
+	if (!shot.empty()) {
+		if (RendererImpl::instance().saveFrame(shot))
+			Log::info("Headless", "last frame saved to " + shot);
+		else
+			Log::err("Headless", "could not save frame to " + shot);
+	}
+}
+
+bool GameWindowImpl::isDown(Gosu::Button) const
+{
+	return false;
+}
+
+void GameWindowImpl::drawRect(double x1, double x2, double y1, double y2,
+                              Gosu::Color c, double z)
+{
+	RendererImpl::instance().drawRect(x1, x2, y1, y2, c, z);
+}
+
+void GameWindowImpl::pushClip(double x, double y, double w, double h)
+{
+	RendererImpl::instance().pushClip(x, y, w, h);
+}
+
+void GameWindowImpl::popClip()
+{
+	RendererImpl::instance().popClip();
+}
+
+void GameWindowImpl::pushTransform(const Gosu::Transform& t)
+{
+	RendererImpl::instance().pushTransform(t);
+}
+
+void GameWindowImpl::popTransform()
+{
+	RendererImpl::instance().popTransform();
+}
+
+time_t GameWindowImpl::readClock() const
+{
+	return clock;
+}
+
+void GameWindowImpl::report()
+{
+	RendererImpl& renderer = RendererImpl::instance();
+	long draws = (long)renderer.draws();
+	long rects = (long)renderer.rects();
+
+	Log::info("Headless", Formatter("% updates over % simulated ms "
+		"took % ms (% ms each)")
+		% updates % (long)clock % updateTime.count()
+		% (updates ? updateTime.count() / (double)updates : 0.0));
+	Log::info("Headless", Formatter("% updates were followed by idle "
+		"time a real window would sleep through")
+		% idles);
+	Log::info("Headless", Formatter("% frames drawn took % ms "
+		"(% ms each)")
+		% redraws % drawTime.count()
+		% (redraws ? drawTime.count() / (double)redraws : 0.0));
+	Log::info("Headless", Formatter("% images and % rectangles drawn "
+		"(% images per frame)")
+		% draws % rects
+		% (redraws ? (double)draws / (double)redraws : 0.0));
+}
+
@@ -32,11 +32,11 @@
 BitRecord BitRecord::fromGosuInput()
 {
 	size_t cnt = Gosu::numButtons;
-	Gosu::Input& in = GameWindow::instance().input();
+	const GameWindow& window = GameWindow::instance();
 
 	BitRecord rec(cnt);
 	for (size_t i = 0; i < cnt; i++)
-		rec.states[i] = in.down(Gosu::Button((unsigned)i));
+		rec.states[i] = window.isDown(Gosu::Button((unsigned)i));
 
 	return rec;
 }
@@ -0,0 +1,66 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** canvas.h                           **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <memory>
+
+#include "image.h"
+
+/**
+ * A blank, CPU-side bitmap that Images can be copied into. A Canvas can be
+ * filled from any thread, but must be turned into an Image on the main
+ * thread, since that is where the graphics context lives.
+ *
+ * Used to bake many small Images, such as the static tiles of a layer, into
+ * one larger Image that can be drawn with a single call.
+ */
+class Canvas
+{
+public:
+	static Canvas* create(unsigned width, unsigned height);
+	virtual ~Canvas();
+
+	//! Copy an Image's pixels onto the canvas with its upper-left corner
+	//! at (dstX, dstY). Overwrites, does not blend. Thread-safe as long
+	//! as each Canvas is only filled by one thread at a time.
+	virtual void blit(const Image& img, unsigned dstX, unsigned dstY) = 0;
+
+	//! Create a new Image from the contents of this Canvas. Main thread
+	//! only.
+	virtual Image* toImage() = 0;
+
+private:
+	Canvas();
+
+	friend class CanvasImpl;
+};
+
+typedef std::shared_ptr<Canvas> CanvasRef;
+
+#endif
+
@@ -42,6 +42,17 @@ Conf::Conf()
 {
 	persistInit = 0;
 	persistCons = 0;
+	idleSleep = DEF_ENGINE_IDLESLEEP;
+	maxFrameSkip = DEF_ENGINE_FRAMESKIP;
+	renderThread = DEF_ENGINE_RENDERTHREAD;
+	jobThreads = DEF_ENGINE_JOBTHREADS;
+	strictXML = DEF_ENGINE_STRICTXML;
+	upscale = DEF_WINDOW_UPSCALE;
+	compactTextures = DEF_WINDOW_COMPACTTEXTURES;
+	cacheVideoMemory = DEF_CACHE_VIDEOMEMORY;
+	headlessFrames = DEF_HEADLESS_FRAMES;
+	headlessFrameTime = DEF_HEADLESS_FRAMETIME;
+	headlessRender = DEF_HEADLESS_RENDER;
 }
 
 bool Conf::validate(const std::string& filename)
@@ -64,18 +75,40 @@ static void defaultsQuery()
 		<< DEF_ENGINE_VERBOSITY << std::endl;
 	std::cerr << "DEF_ENGINE_HALTING:                  "
 		<< DEF_ENGINE_HALTING << std::endl;
+	std::cerr << "DEF_ENGINE_IDLESLEEP:                "
+		<< DEF_ENGINE_IDLESLEEP << std::endl;
+	std::cerr << "DEF_ENGINE_FRAMESKIP:                "
+		<< DEF_ENGINE_FRAMESKIP << std::endl;
+	std::cerr << "DEF_ENGINE_RENDERTHREAD:             "
+		<< DEF_ENGINE_RENDERTHREAD << std::endl;
+	std::cerr << "DEF_ENGINE_JOBTHREADS:               "
+		<< DEF_ENGINE_JOBTHREADS << std::endl;
+	std::cerr << "DEF_ENGINE_STRICTXML:                "
+		<< DEF_ENGINE_STRICTXML << std::endl;
 	std::cerr << "DEF_WINDOW_WIDTH:                    "
 		<< DEF_WINDOW_WIDTH << std::endl;
 	std::cerr << "DEF_WINDOW_HEIGHT:                   "
 		<< DEF_WINDOW_HEIGHT << std::endl;
 	std::cerr << "DEF_WINDOW_FULLSCREEN:               "
 		<< DEF_WINDOW_FULLSCREEN << std::endl;
+	std::cerr << "DEF_WINDOW_UPSCALE:                  "
+		<< DEF_WINDOW_UPSCALE << std::endl;
+	std::cerr << "DEF_WINDOW_COMPACTTEXTURES:          "
+		<< DEF_WINDOW_COMPACTTEXTURES << std::endl;
 	std::cerr << "DEF_CACHE_ENABLED:                   "
 		<< DEF_CACHE_ENABLED << std::endl;
 	std::cerr << "DEF_CACHE_TTL:                       "
 		<< DEF_CACHE_TTL << std::endl;
 	std::cerr << "DEF_CACHE_SIZE:                      "
 		<< DEF_CACHE_SIZE << std::endl;
+	std::cerr << "DEF_CACHE_VIDEOMEMORY:               "
+		<< DEF_CACHE_VIDEOMEMORY << std::endl;
+	std::cerr << "DEF_HEADLESS_FRAMES:                 "
+		<< DEF_HEADLESS_FRAMES << std::endl;
+	std::cerr << "DEF_HEADLESS_FRAMETIME:              "
+		<< DEF_HEADLESS_FRAMETIME << std::endl;
+	std::cerr << "DEF_HEADLESS_RENDER:                 "
+		<< DEF_HEADLESS_RENDER << std::endl;
 }
 
 // Parse and process the client config file, and set configuration defaults for
@@ -101,9 +134,18 @@ bool parseConfig(const std::string& filename)
 
 	conf.worldFilename = ini.get("engine.world", "");
 	conf.dataPath = splitStr(ini.get("engine.datapath", ""), ",");
+	conf.idleSleep = ini.get("engine.idlesleep", DEF_ENGINE_IDLESLEEP);
+	conf.maxFrameSkip = ini.get("engine.frameskip", DEF_ENGINE_FRAMESKIP);
+	conf.renderThread = ini.get("engine.renderthread",
+	                            DEF_ENGINE_RENDERTHREAD);
+	conf.jobThreads = ini.get("engine.jobthreads", DEF_ENGINE_JOBTHREADS);
+	conf.strictXML = ini.get("engine.strictxml", DEF_ENGINE_STRICTXML);
 	conf.windowSize.x = ini.get("window.width", DEF_WINDOW_WIDTH);
 	conf.windowSize.y = ini.get("window.height", DEF_WINDOW_HEIGHT);
 	conf.fullscreen = ini.get("window.fullscreen", DEF_WINDOW_FULLSCREEN);
+	conf.upscale = ini.get("window.upscale", DEF_WINDOW_UPSCALE);
+	conf.compactTextures = ini.get("window.compacttextures",
+	                               DEF_WINDOW_COMPACTTEXTURES);
 	conf.audioEnabled = ini.get("audio.enabled", true);
 	conf.cacheEnabled = ini.get("cache.enabled", DEF_CACHE_ENABLED);
 
@@ -127,6 +169,17 @@ bool parseConfig(const std::string& filename)
 	if (!conf.cacheSize)
 		conf.cacheEnabled = false;
 
+	conf.cacheVideoMemory = ini.get("cache.videomemory",
+	                                DEF_CACHE_VIDEOMEMORY);
+
+	conf.headlessFrames = ini.get("headless.frames", DEF_HEADLESS_FRAMES);
+	conf.headlessFrameTime = ini.get("headless.frametime",
+	                                 DEF_HEADLESS_FRAMETIME);
+	if (conf.headlessFrameTime < 1)
+		conf.headlessFrameTime = 1;
+	conf.headlessRender = ini.get("headless.render", DEF_HEADLESS_RENDER);
+	conf.headlessScreenshot = ini.get("headless.screenshot", "");
+
 	std::string verbosity = ini.get("engine.verbosity", DEF_ENGINE_VERBOSITY);
 	if (verbosity.empty())
 		;
@@ -182,6 +235,8 @@ bool parseCommandLine(int argc, char* argv[])
 	cmd.insert("",   "--no-audio",     "",                "Disable audio");
 	cmd.insert("",   "--volume-music", "<0-100>",         "Set music volume");
 	cmd.insert("",   "--volume-sound", "<0-100>",         "Set sound effects volume");
+	cmd.insert("",   "--frames",       "<count>",         "Updates to run in a headless build");
+	cmd.insert("",   "--screenshot",   "<file>",          "Save a headless build's last frame");
 	cmd.insert("",   "--query",        "",                "Query compiled-in engine defaults");
 	cmd.insert("",   "--version",      "",                "Print the engine version string");
 	
@@ -269,6 +324,12 @@ bool parseCommandLine(int argc, char* argv[])
 	if (cmd.check("--volume-sound"))
 		conf.soundVolume = parseInt100(cmd.get("--volume-sound"));
 
+	if (cmd.check("--frames"))
+		conf.headlessFrames = parseUInt(cmd.get("--frames"));
+
+	if (cmd.check("--screenshot"))
+		conf.headlessScreenshot = cmd.get("--screenshot");
+
 	if (cmd.check("--cache-ttl")) {
 		conf.cacheTTL = parseUInt(cmd.get("--cache-ttl"));
 		if (conf.cacheTTL == 0)
@@ -47,12 +47,23 @@
 // === Client.ini Default Values ===
 	#define DEF_ENGINE_VERBOSITY  "verbose"
 	#define DEF_ENGINE_HALTING    "fatal"
+	#define DEF_ENGINE_IDLESLEEP  100
+	#define DEF_ENGINE_FRAMESKIP  3
+	#define DEF_ENGINE_RENDERTHREAD false
+	#define DEF_ENGINE_JOBTHREADS 0
+	#define DEF_ENGINE_STRICTXML  false
 	#define DEF_WINDOW_WIDTH      640
 	#define DEF_WINDOW_HEIGHT     480
 	#define DEF_WINDOW_FULLSCREEN false
+	#define DEF_WINDOW_UPSCALE    false
+	#define DEF_WINDOW_COMPACTTEXTURES false
 	#define DEF_CACHE_ENABLED     true
 	#define DEF_CACHE_TTL         300
 	#define DEF_CACHE_SIZE        100
+	#define DEF_CACHE_VIDEOMEMORY 0
+	#define DEF_HEADLESS_FRAMES   600
+	#define DEF_HEADLESS_FRAMETIME 16
+	#define DEF_HEADLESS_RENDER   false
 // ===
 
 //! Game Movement Mode
@@ -84,16 +95,28 @@ struct Conf {
 	verbosity_t verbosity;
 	movement_mode_t moveMode;
 	halting_mode_t halting;
+	int idleSleep;
+	int maxFrameSkip;
+	bool renderThread;
+	int jobThreads;
+	bool strictXML;
 	icoord windowSize;
 	bool fullscreen;
+	bool upscale;
+	bool compactTextures;
 	bool audioEnabled;
 	int musicVolume;
 	int soundVolume;
 	bool cacheEnabled;
 	int cacheTTL;
 	int cacheSize;
+	int cacheVideoMemory;
 	int persistInit;
 	int persistCons;
+	int headlessFrames;
+	int headlessFrameTime;
+	bool headlessRender;
+	std::string headlessScreenshot;
 };
 extern Conf conf;
 
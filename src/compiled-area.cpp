@@ -0,0 +1,512 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** compiled-area.cpp                  **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <math.h>
+#include <string.h>
+
+#include <set>
+
+#include "compiled-area.h"
+#include "formatter.h"
+#include "log.h"
+
+CompiledArea::CompiledArea()
+	: width(0), height(0), depth(0),
+	  tileWidth(0), tileHeight(0),
+	  name(NO_STRING), introMusic(NO_STRING), loopMusic(NO_STRING),
+	  loadScript(NO_STRING), focusScript(NO_STRING),
+	  tickScript(NO_STRING), turnScript(NO_STRING),
+	  loopX(0), loopY(0),
+	  hasColorOverlay(0), colorOverlay(0)
+{
+}
+
+/*
+ * Numbers are put together a byte at a time, so files are the same whatever
+ * the host's byte order. The tile planes are the exception: where the host is
+ * little-endian they are copied in and out whole.
+ */
+
+static bool hostIsLittleEndian()
+{
+	const uint16_t one = 1;
+	unsigned char first;
+	memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+static void putU8(std::string& out, uint8_t v)
+{
+	out.push_back((char)v);
+}
+
+static void putU32(std::string& out, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((char)(v >> (8 * i)));
+}
+
+static void putI32(std::string& out, int32_t v)
+{
+	putU32(out, (uint32_t)v);
+}
+
+static void putU64(std::string& out, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+		out.push_back((char)(v >> (8 * i)));
+}
+
+static void putDouble(std::string& out, double v)
+{
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	putU64(out, bits);
+}
+
+static void putString(std::string& out, const std::string& s)
+{
+	putU32(out, (uint32_t)s.size());
+	out.append(s);
+}
+
+//! Store a tile plane. T is a 32-bit integer.
+template<class T>
+static void putPlane(std::string& out, const std::vector<T>& plane)
+{
+	putU32(out, (uint32_t)plane.size());
+	if (hostIsLittleEndian())
+		out.append((const char*)plane.data(), plane.size() * 4);
+	else
+		for (size_t i = 0; i < plane.size(); i++)
+			putU32(out, (uint32_t)plane[i]);
+}
+
+static void putRegion(std::string& out, const CompiledArea::Region& r)
+{
+	putI32(out, r.x);
+	putI32(out, r.y);
+	putI32(out, r.z);
+	putI32(out, r.w);
+	putI32(out, r.h);
+}
+
+std::string writeCompiledArea(const CompiledArea& area)
+{
+	std::string out = COMPILED_AREA_MAGIC;
+	putU32(out, COMPILED_AREA_VERSION);
+
+	putU32(out, (uint32_t)area.sources.size());
+	for (size_t i = 0; i < area.sources.size(); i++) {
+		putString(out, area.sources[i].name);
+		putU64(out, area.sources[i].hash);
+	}
+	putU32(out, (uint32_t)area.strings.size());
+	for (size_t i = 0; i < area.strings.size(); i++)
+		putString(out, area.strings[i]);
+
+	putI32(out, area.width);
+	putI32(out, area.height);
+	putI32(out, area.depth);
+	putI32(out, area.tileWidth);
+	putI32(out, area.tileHeight);
+
+	putI32(out, area.name);
+	putI32(out, area.introMusic);
+	putI32(out, area.loopMusic);
+	putI32(out, area.loadScript);
+	putI32(out, area.focusScript);
+	putI32(out, area.tickScript);
+	putI32(out, area.turnScript);
+	putU8(out, area.loopX);
+	putU8(out, area.loopY);
+	putU8(out, area.hasColorOverlay);
+	putU32(out, area.colorOverlay);
+
+	putU32(out, (uint32_t)area.depths.size());
+	for (size_t i = 0; i < area.depths.size(); i++)
+		putDouble(out, area.depths[i]);
+
+	putU32(out, (uint32_t)area.tileSets.size());
+	for (size_t i = 0; i < area.tileSets.size(); i++) {
+		const CompiledArea::TileSet& set = area.tileSets[i];
+		putI32(out, set.image);
+		putI32(out, set.width);
+		putI32(out, set.height);
+	}
+
+	putU32(out, (uint32_t)area.tileTypes.size());
+	for (size_t i = 0; i < area.tileTypes.size(); i++) {
+		const CompiledArea::TileType& type = area.tileTypes[i];
+		putI32(out, type.gid);
+		putI32(out, type.tileSet);
+		putI32(out, type.id);
+		putU32(out, type.flags);
+		putI32(out, type.enterScript);
+		putI32(out, type.leaveScript);
+		putI32(out, type.useScript);
+		putI32(out, type.frameLen);
+		putI32(out, type.cycles);
+		putPlane(out, type.frames);
+	}
+
+	putPlane(out, area.gids);
+	putPlane(out, area.flags);
+
+	putU32(out, (uint32_t)area.scripts.size());
+	for (size_t i = 0; i < area.scripts.size(); i++) {
+		const CompiledArea::ScriptRegion& script = area.scripts[i];
+		putRegion(out, script.r);
+		putI32(out, script.enterScript);
+		putI32(out, script.leaveScript);
+		putI32(out, script.useScript);
+	}
+
+	putU32(out, (uint32_t)area.exits.size());
+	for (size_t i = 0; i < area.exits.size(); i++) {
+		const CompiledArea::ExitRegion& exit = area.exits[i];
+		putRegion(out, exit.r);
+		putI32(out, exit.dir);
+		putI32(out, exit.area);
+		putI32(out, exit.x);
+		putI32(out, exit.y);
+		putDouble(out, exit.z);
+		putU8(out, exit.wwide);
+		putU8(out, exit.hwide);
+	}
+
+	putU32(out, (uint32_t)area.layermods.size());
+	for (size_t i = 0; i < area.layermods.size(); i++) {
+		const CompiledArea::LayermodRegion& layermod = area.layermods[i];
+		putRegion(out, layermod.r);
+		putI32(out, layermod.dir);
+		putDouble(out, layermod.mod);
+	}
+
+	return out;
+}
+
+//! Where we are in a file being read. Once bad is set, everything read
+//! after is zero.
+struct Input
+{
+	const unsigned char* pos;
+	const unsigned char* end;
+	bool bad;
+};
+
+//! Make sure n more bytes can be read.
+static bool have(Input& in, size_t n)
+{
+	if (in.bad || (size_t)(in.end - in.pos) < n)
+		in.bad = true;
+	return !in.bad;
+}
+
+static uint8_t getU8(Input& in)
+{
+	if (!have(in, 1))
+		return 0;
+	return *in.pos++;
+}
+
+static uint32_t getU32(Input& in)
+{
+	if (!have(in, 4))
+		return 0;
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++)
+		v |= (uint32_t)*in.pos++ << (8 * i);
+	return v;
+}
+
+static int32_t getI32(Input& in)
+{
+	return (int32_t)getU32(in);
+}
+
+static uint64_t getU64(Input& in)
+{
+	if (!have(in, 8))
+		return 0;
+	uint64_t v = 0;
+	for (int i = 0; i < 8; i++)
+		v |= (uint64_t)*in.pos++ << (8 * i);
+	return v;
+}
+
+static double getDouble(Input& in)
+{
+	uint64_t bits = getU64(in);
+	double v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+//! Read the length of something that takes at least size bytes per item.
+//! A damaged length is caught here, before anything is allocated for it.
+static size_t getCount(Input& in, size_t size)
+{
+	size_t count = getU32(in);
+	if (!have(in, count * size))
+		return 0;
+	return count;
+}
+
+static std::string getString(Input& in)
+{
+	size_t size = getCount(in, 1);
+	std::string s((const char*)in.pos, size);
+	in.pos += size;
+	return s;
+}
+
+template<class T>
+static void getPlane(Input& in, std::vector<T>& plane)
+{
+	size_t count = getCount(in, 4);
+	plane.resize(count);
+	if (hostIsLittleEndian()) {
+		memcpy(plane.data(), in.pos, count * 4);
+		in.pos += count * 4;
+	}
+	else
+		for (size_t i = 0; i < count; i++)
+			plane[i] = (T)getU32(in);
+}
+
+static void getRegion(Input& in, CompiledArea::Region& r)
+{
+	r.x = getI32(in);
+	r.y = getI32(in);
+	r.z = getI32(in);
+	r.w = getI32(in);
+	r.h = getI32(in);
+}
+
+static bool validString(const CompiledArea& area, int32_t idx)
+{
+	return idx == NO_STRING || (0 <= idx &&
+		(size_t)idx < area.strings.size());
+}
+
+static bool validRegion(const CompiledArea& area,
+	const CompiledArea::Region& r)
+{
+	return 0 <= r.x && 0 <= r.w && r.x + r.w <= area.width &&
+	       0 <= r.y && 0 <= r.h && r.y + r.h <= area.height &&
+	       0 <= r.z && r.z < area.depth;
+}
+
+static bool validDirection(int32_t dir)
+{
+	return 0 <= dir && dir < 5;
+}
+
+//! Check that every index in a compiled Area points at something, so that
+//! AreaBinary can use them without looking.
+static bool validate(const CompiledArea& area)
+{
+	if (area.width < 0 || area.height < 0 || area.depth < 0 ||
+	    area.depths.size() != (size_t)area.depth)
+		return false;
+	size_t tiles = (size_t)area.width * (size_t)area.height *
+	               (size_t)area.depth;
+	if (area.gids.size() != tiles || area.flags.size() != tiles)
+		return false;
+	if (area.tileWidth <= 0 || area.tileHeight <= 0)
+		return false;
+
+	// Each layer needs a depth of its own, or Area::depth2idx would
+	// lose one.
+	std::set<double> depths;
+	for (size_t i = 0; i < area.depths.size(); i++)
+		if (isnan(area.depths[i]) ||
+		    !depths.insert(area.depths[i]).second)
+			return false;
+
+	if (!validString(area, area.name) ||
+	    !validString(area, area.introMusic) ||
+	    !validString(area, area.loopMusic) ||
+	    !validString(area, area.loadScript) ||
+	    !validString(area, area.focusScript) ||
+	    !validString(area, area.tickScript) ||
+	    !validString(area, area.turnScript))
+		return false;
+
+	for (size_t i = 0; i < area.tileSets.size(); i++) {
+		const CompiledArea::TileSet& set = area.tileSets[i];
+		if (set.image == NO_STRING || !validString(area, set.image) ||
+		    set.width < 0 || set.height < 0)
+			return false;
+	}
+	for (size_t i = 0; i < area.tileTypes.size(); i++) {
+		const CompiledArea::TileType& type = area.tileTypes[i];
+		if (type.tileSet < 0 ||
+		    (size_t)type.tileSet >= area.tileSets.size() ||
+		    !validString(area, type.enterScript) ||
+		    !validString(area, type.leaveScript) ||
+		    !validString(area, type.useScript))
+			return false;
+	}
+	for (size_t i = 0; i < area.scripts.size(); i++) {
+		const CompiledArea::ScriptRegion& script = area.scripts[i];
+		if (!validRegion(area, script.r) ||
+		    !validString(area, script.enterScript) ||
+		    !validString(area, script.leaveScript) ||
+		    !validString(area, script.useScript))
+			return false;
+	}
+	for (size_t i = 0; i < area.exits.size(); i++) {
+		const CompiledArea::ExitRegion& exit = area.exits[i];
+		if (!validRegion(area, exit.r) || !validDirection(exit.dir) ||
+		    exit.area == NO_STRING || !validString(area, exit.area))
+			return false;
+	}
+	for (size_t i = 0; i < area.layermods.size(); i++) {
+		const CompiledArea::LayermodRegion& layermod = area.layermods[i];
+		if (!validRegion(area, layermod.r) ||
+		    !validDirection(layermod.dir))
+			return false;
+	}
+	return true;
+}
+
+bool readCompiledArea(const std::string& path, const char* data,
+	size_t size, CompiledArea& area)
+{
+	Input in;
+	in.pos = (const unsigned char*)data;
+	in.end = in.pos + size;
+	in.bad = false;
+
+	if (!have(in, 4) || memcmp(in.pos, COMPILED_AREA_MAGIC, 4) != 0) {
+		Log::err(path, "not a compiled Area");
+		return false;
+	}
+	in.pos += 4;
+	uint32_t version = getU32(in);
+	if (version != COMPILED_AREA_VERSION) {
+		Log::info(path, Formatter("compiled for version % of the "
+			"format, not %") % version % COMPILED_AREA_VERSION);
+		return false;
+	}
+
+	area.sources.resize(getCount(in, 12));
+	for (size_t i = 0; i < area.sources.size(); i++) {
+		area.sources[i].name = getString(in);
+		area.sources[i].hash = getU64(in);
+	}
+	area.strings.resize(getCount(in, 4));
+	for (size_t i = 0; i < area.strings.size(); i++)
+		area.strings[i] = getString(in);
+
+	area.width = getI32(in);
+	area.height = getI32(in);
+	area.depth = getI32(in);
+	area.tileWidth = getI32(in);
+	area.tileHeight = getI32(in);
+
+	area.name = getI32(in);
+	area.introMusic = getI32(in);
+	area.loopMusic = getI32(in);
+	area.loadScript = getI32(in);
+	area.focusScript = getI32(in);
+	area.tickScript = getI32(in);
+	area.turnScript = getI32(in);
+	area.loopX = getU8(in);
+	area.loopY = getU8(in);
+	area.hasColorOverlay = getU8(in);
+	area.colorOverlay = getU32(in);
+
+	area.depths.resize(getCount(in, 8));
+	for (size_t i = 0; i < area.depths.size(); i++)
+		area.depths[i] = getDouble(in);
+
+	area.tileSets.resize(getCount(in, 12));
+	for (size_t i = 0; i < area.tileSets.size(); i++) {
+		CompiledArea::TileSet& set = area.tileSets[i];
+		set.image = getI32(in);
+		set.width = getI32(in);
+		set.height = getI32(in);
+	}
+
+	area.tileTypes.resize(getCount(in, 40));
+	for (size_t i = 0; i < area.tileTypes.size(); i++) {
+		CompiledArea::TileType& type = area.tileTypes[i];
+		type.gid = getI32(in);
+		type.tileSet = getI32(in);
+		type.id = getI32(in);
+		type.flags = getU32(in);
+		type.enterScript = getI32(in);
+		type.leaveScript = getI32(in);
+		type.useScript = getI32(in);
+		type.frameLen = getI32(in);
+		type.cycles = getI32(in);
+		getPlane(in, type.frames);
+	}
+
+	getPlane(in, area.gids);
+	getPlane(in, area.flags);
+
+	area.scripts.resize(getCount(in, 32));
+	for (size_t i = 0; i < area.scripts.size(); i++) {
+		CompiledArea::ScriptRegion& script = area.scripts[i];
+		getRegion(in, script.r);
+		script.enterScript = getI32(in);
+		script.leaveScript = getI32(in);
+		script.useScript = getI32(in);
+	}
+
+	area.exits.resize(getCount(in, 46));
+	for (size_t i = 0; i < area.exits.size(); i++) {
+		CompiledArea::ExitRegion& exit = area.exits[i];
+		getRegion(in, exit.r);
+		exit.dir = getI32(in);
+		exit.area = getI32(in);
+		exit.x = getI32(in);
+		exit.y = getI32(in);
+		exit.z = getDouble(in);
+		exit.wwide = getU8(in);
+		exit.hwide = getU8(in);
+	}
+
+	area.layermods.resize(getCount(in, 32));
+	for (size_t i = 0; i < area.layermods.size(); i++) {
+		CompiledArea::LayermodRegion& layermod = area.layermods[i];
+		getRegion(in, layermod.r);
+		layermod.dir = getI32(in);
+		layermod.mod = getDouble(in);
+	}
+
+	if (in.bad || in.pos != in.end || !validate(area)) {
+		Log::err(path, "compiled Area is damaged");
+		return false;
+	}
+	return true;
+}
+
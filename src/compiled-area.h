@@ -0,0 +1,155 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** compiled-area.h                    **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef COMPILED_AREA_H
+#define COMPILED_AREA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//! First four bytes of every compiled Area.
+#define COMPILED_AREA_MAGIC "TSNA"
+
+//! Bumped whenever the layout of CompiledArea changes. Compiled Areas of
+//! any other version are ignored.
+#define COMPILED_AREA_VERSION 1
+
+//! Added to an Area's filename to find its compiled copy.
+#define COMPILED_AREA_SUFFIX ".bin"
+
+//! A string index that refers to no string.
+#define NO_STRING -1
+
+/**
+ * An Area with its TMX and TSX files already parsed, validated and resolved
+ * into numbers by TMXParser. Made ahead of time by tsunagari-compile, or on
+ * load by AreaTMX, and built into an Area by AreaBinary.
+ *
+ * In the file, fields follow the magic and the version in the order they are
+ * declared here. Numbers are little-endian. Strings and vectors are preceded
+ * by their length as a 32-bit number. Every string the Area uses is stored
+ * once in strings and referred to by its index.
+ */
+struct CompiledArea
+{
+	//! An empty Area, with no strings set.
+	CompiledArea();
+
+	//! A file the Area was compiled from and a hash of what it held.
+	//! The compiled Area is out of date if any of them has changed.
+	struct Source
+	{
+		std::string name;
+		uint64_t hash;
+	};
+
+	//! A tileset image, split into width x height tiles. Each tile gets
+	//! the next gid, starting from 1 for the first tileset.
+	struct TileSet
+	{
+		int32_t image;
+		int32_t width, height;
+	};
+
+	//! A tile with properties of its own.
+	struct TileType
+	{
+		int32_t gid;
+		int32_t tileSet, id;
+		uint32_t flags;
+		int32_t enterScript, leaveScript, useScript;
+		int32_t frameLen, cycles; //!< frameLen is -1 if not animated.
+		std::vector<int32_t> frames;
+	};
+
+	//! A rectangle of Tiles that an <object> applies to.
+	struct Region
+	{
+		int32_t x, y, z, w, h;
+	};
+
+	struct ScriptRegion
+	{
+		Region r;
+		int32_t enterScript, leaveScript, useScript;
+	};
+
+	//! Wide exits add each Tile's offset into the region to the
+	//! destination's x or y.
+	struct ExitRegion
+	{
+		Region r;
+		int32_t dir; //!< ExitDirection
+		int32_t area;
+		int32_t x, y;
+		double z;
+		uint8_t wwide, hwide;
+	};
+
+	struct LayermodRegion
+	{
+		Region r;
+		int32_t dir; //!< ExitDirection
+		double mod;
+	};
+
+	std::vector<Source> sources;
+	std::vector<std::string> strings;
+
+	int32_t width, height, depth;
+	int32_t tileWidth, tileHeight;
+
+	int32_t name, introMusic, loopMusic;
+	int32_t loadScript, focusScript, tickScript, turnScript;
+	uint8_t loopX, loopY;
+	uint8_t hasColorOverlay;
+	uint32_t colorOverlay; //!< ARGB
+
+	std::vector<double> depths; //!< Virtual depth of each layer.
+	std::vector<TileSet> tileSets;
+	std::vector<TileType> tileTypes;
+
+	std::vector<int32_t> gids;   //!< Indexed by [z][y][x]. 0 is no tile.
+	std::vector<uint32_t> flags; //!< Indexed by [z][y][x].
+
+	std::vector<ScriptRegion> scripts;
+	std::vector<ExitRegion> exits;
+	std::vector<LayermodRegion> layermods;
+};
+
+//! Lay out a compiled Area as it is stored on disk.
+std::string writeCompiledArea(const CompiledArea& area);
+
+//! Read a compiled Area from the bytes of its file. Logs under path and
+//! returns false if it is of another version or is damaged.
+bool readCompiledArea(const std::string& path, const char* data,
+	size_t size, CompiledArea& area);
+
+#endif
+
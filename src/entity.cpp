@@ -51,8 +51,7 @@ static std::string directions[][3] = {
 
 
 Entity::Entity()
-	: redraw(true),
-	  area(NULL),
+	: area(NULL),
 	  r(0.0, 0.0, 0.0),
 	  frozen(false),
 	  speedMul(1.0),
@@ -60,6 +59,8 @@ Entity::Entity()
 	  stillMoving(false),
 	  nowalkFlags(TILE_NOWALK | TILE_NOWALK_NPC),
 	  nowalkExempt(0),
+	  drawn(false),
+	  drawnImg(NULL),
 	  phase(NULL),
 	  phaseName("")
 {
@@ -91,26 +92,77 @@ void Entity::destroy()
 	delete this;
 }
 
-void Entity::draw()
+bool Entity::draw()
 {
-	redraw = false;
 	if (!phase)
-		return;
+		return false;
+
+	rvec2 shift;
+	if (!area->onScreen(rvec2(doff.x + r.x, doff.y + r.y), imgsz, &shift))
+		return false;
+	double x = doff.x + r.x + shift.x;
+	double y = doff.y + r.y + shift.y;
+	if (!area->isDamaged(x, y, x + imgsz.x, y + imgsz.y))
+		return true;
 
 	time_t now = World::instance()->time();
 	Image* img = phase->frame(now);
 
 	img->draw(
-		doff.x + r.x,
-		doff.y + r.y,
-		r.z + area->isometricZOff(rvec2(r.x, r.y))
+		x,
+		y,
+		r.z + area->isometricZOff(rvec2(r.x + shift.x, r.y + shift.y))
 	);
+	return true;
+}
+
+void Entity::findDamage()
+{
+	bool visible = false;
+	rvec2 pos, shift;
+	const Image* img = NULL;
+
+	if (phase) {
+		pos = rvec2(doff.x + r.x, doff.y + r.y);
+		visible = area->onScreen(pos, imgsz, &shift);
+	}
+	if (visible) {
+		pos = pos + shift;
+		img = phase->frame(World::instance()->time());
+	}
+
+	if (visible == drawn &&
+	    (!visible || (pos == drawnPos && img == drawnImg)))
+		return;
+
+	undraw();
+	if (visible)
+		area->damage(pos.x, pos.y, pos.x + imgsz.x, pos.y + imgsz.y);
+	drawn = visible;
+	drawnPos = pos;
+	drawnImg = img;
 }
 
-bool Entity::needsRedraw() const
+void Entity::undraw()
 {
+	if (area && drawn)
+		area->damage(drawnPos.x, drawnPos.y,
+		             drawnPos.x + imgsz.x, drawnPos.y + imgsz.y);
+	drawn = false;
+}
+
+time_t Entity::nextFrameTime() const
+{
+	if (!phase)
+		return ANIM_NEVER;
 	time_t now = World::instance()->time();
-	return redraw || (phase && phase->needsRedraw(now));
+	return phase->nextFrameTime(now);
+}
+
+void Entity::requestRedraw()
+{
+	if (area)
+		area->requestRedraw();
 }
 
 
@@ -140,7 +192,7 @@ void Entity::tickTile(time_t dt)
 	if (!moving)
 		return;
 
-	redraw = true;
+	requestRedraw();
 	double traveled = speed * (double)dt;
 	double destDist = Gosu::distance(r.x, r.y, destCoord.x, destCoord.y);
 	if (destDist <= traveled) {
@@ -215,7 +267,7 @@ void Entity::setTileCoords(int x, int y)
 {
 	leaveTile();
 	vicoord virt(x, y, r.z);
-	redraw = true;
+	requestRedraw();
 	r = area->virt2virt(virt);
 	enterTile();
 }
@@ -224,7 +276,7 @@ void Entity::setTileCoords(int x, int y, double z)
 {
 	leaveTile();
 	vicoord virt(x, y, z);
-	redraw = true;
+	requestRedraw();
 	r = area->virt2virt(virt);
 	enterTile();
 }
@@ -232,7 +284,7 @@ void Entity::setTileCoords(int x, int y, double z)
 void Entity::setTileCoords(icoord phys)
 {
 	leaveTile();
-	redraw = true;
+	requestRedraw();
 	r = area->phys2virt_r(phys);
 	enterTile();
 }
@@ -240,7 +292,7 @@ void Entity::setTileCoords(icoord phys)
 void Entity::setTileCoords(vicoord virt)
 {
 	leaveTile();
-	redraw = true;
+	requestRedraw();
 	r = area->virt2virt(virt);
 	enterTile();
 }
@@ -248,7 +300,7 @@ void Entity::setTileCoords(vicoord virt)
 void Entity::setTileCoords(rcoord virt)
 {
 	leaveTile();
-	redraw = true;
+	requestRedraw();
 	r = virt;
 	enterTile();
 }
@@ -337,6 +389,11 @@ bool Entity::isMoving() const
 	return moving || stillMoving;
 }
 
+bool Entity::isIdle() const
+{
+	return !isMoving() && !tickScript;
+}
+
 void Entity::moveByTile(int x, int y)
 {
 	moveByTile(ivec2(x, y));
@@ -366,11 +423,13 @@ Area* Entity::getArea()
 
 void Entity::setArea(Area* a)
 {
+	undraw();
 	leaveTile();
 	area = a;
 	calcDraw();
 	setSpeed(speedMul); // Calculate new speed based on tile size.
 	enterTile();
+	requestRedraw();
 }
 
 double Entity::getSpeed() const
@@ -464,7 +523,7 @@ enum SetPhaseResult Entity::_setPhase(const std::string& name)
 		phase = newPhase;
 		phase->startOver(now, ANIM_INFINITE_CYCLES);
 		phaseName = name;
-		redraw = true;
+		requestRedraw();
 		return PHASE_CHANGED;
 	}
 	return PHASE_NOTCHANGED;
@@ -515,7 +574,7 @@ void Entity::preMove()
 
 	if (conf.moveMode == TURN) {
 		// Movement is instantaneous.
-		redraw = true;
+		requestRedraw();
 		r = destCoord;
 		postMove();
 	}
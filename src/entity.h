@@ -77,9 +77,21 @@ public:
 	//! Entity destroyer.
 	virtual void destroy();
 
-	//! Gosu Callback
-	void draw();
-	bool needsRedraw() const;
+	//! Gosu Callback. Returns false without touching the animation if the
+	//! Entity is off-screen.
+	bool draw();
+
+	//! Compare how this Entity looks now with how it was last drawn and
+	//! damage whatever changed on our Area. Called before each draw.
+	void findDamage();
+
+	//! Damage where this Entity was last drawn. Called when it leaves its
+	//! Area.
+	void undraw();
+
+	//! When will this Entity's phase animation next change frames?
+	//! ANIM_NEVER if it won't.
+	time_t nextFrameTime() const;
 
 	virtual void tick(time_t dt);
 	void tickTurn(time_t dt);
@@ -130,6 +142,10 @@ public:
 	//! tiles.
 	bool isMoving() const;
 
+	//! Will tick() leave us as we are? False while moving or when we have
+	//! a tick script.
+	bool isIdle() const;
+
 	//! Initiate a movement within the Area.
 	void moveByTile(int x, int y);
 	void moveByTile(ivec2 delta);
@@ -231,13 +247,12 @@ protected:
 
 
 protected:
+	//! Tell our Area that the screen needs to be redrawn.
+	void requestRedraw();
+
 	typedef std::map<std::string, Animation> AnimationMap;
 	typedef std::map<std::string, SampleRef> SampleMap;
 
-
-	//! Set to true if the Entity wants the screen to be redrawn.
-	bool redraw;
-
 	//! Pointer to Area this Entity is located on.
 	Area* area;
 	rcoord r; //!< real x,y position: hold partial pixel transversal
@@ -267,6 +282,12 @@ protected:
 	Tile* destTile;
 
 	ivec2 imgsz;
+
+	// What findDamage() saw, to compare with the next time.
+	bool drawn;
+	rvec2 drawnPos;
+	const Image* drawnImg;
+
 	AnimationMap phases;
 	Animation* phase;
 	std::string phaseName;
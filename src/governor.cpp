@@ -0,0 +1,102 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** governor.cpp                       **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <math.h>
+
+#include "governor.h"
+
+//! Weight of a new measurement in the moving averages.
+#define COST_SMOOTHING 0.1
+
+//! Fraction of the budget frames may use before deferrable work waits, and
+//! the fraction they must fall back under before it resumes.
+#define HEAVY_LOAD 0.9
+#define LIGHT_LOAD 0.6
+
+Governor::Governor(double budget, int maxSkip)
+	: budget(budget),
+	  maxSkip(maxSkip),
+	  updateCost(0.0),
+	  drawCost(0.0),
+	  skip(0),
+	  skipped(0),
+	  loaded(false)
+{
+}
+
+void Governor::updated(double ms)
+{
+	updateCost += (ms - updateCost) * COST_SMOOTHING;
+	adapt();
+}
+
+void Governor::drew(double ms)
+{
+	drawCost += (ms - drawCost) * COST_SMOOTHING;
+	adapt();
+}
+
+bool Governor::skipDraw()
+{
+	if (skipped < skip) {
+		skipped++;
+		return true;
+	}
+	skipped = 0;
+	return false;
+}
+
+bool Governor::hasHeadroom() const
+{
+	return !loaded;
+}
+
+int Governor::frameSkip() const
+{
+	return skip;
+}
+
+void Governor::adapt()
+{
+	double cost = updateCost + drawCost;
+	if (cost > budget * HEAVY_LOAD)
+		loaded = true;
+	else if (cost < budget * LIGHT_LOAD)
+		loaded = false;
+
+	// Spread one draw over enough frames that, together with the updates
+	// that run every frame, the average fits the budget.
+	double spare = budget - updateCost;
+	if (cost <= budget)
+		skip = 0;
+	else if (spare <= 0.0)
+		skip = maxSkip;
+	else {
+		int frames = (int)ceil(drawCost / spare);
+		skip = frames - 1 < maxSkip ? frames - 1 : maxSkip;
+	}
+}
+
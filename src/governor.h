@@ -0,0 +1,78 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** governor.h                         **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+/**
+ * Keeps the frame rate smooth when frames cost more than the time they are
+ * given. It watches how long updates and draws take and, when the two
+ * together run over budget, has the window skip enough redraws that the
+ * average frame fits again. Updates are never skipped, so the game keeps
+ * running at its normal speed and only the picture is shown less often.
+ *
+ * Work that can wait, like cache garbage collection, should ask
+ * hasHeadroom() before running.
+ */
+class Governor
+{
+public:
+	/**
+	 * @param budget milliseconds each frame is given
+	 * @param maxSkip most redraws skipped in a row
+	 */
+	Governor(double budget, int maxSkip);
+
+	//! Record the time one update took, in milliseconds.
+	void updated(double ms);
+
+	//! Record the time one draw took, in milliseconds.
+	void drew(double ms);
+
+	//! Ask before drawing a frame. True if it should be skipped.
+	bool skipDraw();
+
+	//! Is there time to spare for deferrable work?
+	bool hasHeadroom() const;
+
+	//! Redraws currently skipped for every one drawn.
+	int frameSkip() const;
+
+private:
+	void adapt();
+
+	double budget;
+	int maxSkip;
+
+	//! Moving averages, in milliseconds.
+	double updateCost, drawCost;
+
+	int skip, skipped;
+	bool loaded;
+};
+
+#endif
+
@@ -29,11 +29,21 @@
 
 #include <cstring> // for size_t
 #include <memory>
+#include <string>
+
+//! How much of what is beneath an Image shows through it.
+enum ImageOpacity {
+	IMAGE_MIXED,      //!< Some pixels are see-through, or we don't know.
+	IMAGE_OPAQUE,     //!< Every pixel is fully opaque.
+	IMAGE_TRANSPARENT //!< Every pixel is fully transparent.
+};
 
 class Image
 {
 public:
-	static Image* create(void* data, size_t length);
+	//! Decode an image. name is only used in logs.
+	static Image* create(const std::string& name,
+			void* data, size_t length);
 	virtual ~Image() = 0;
 
 	virtual void draw(double dstX, double dstY, double z) const = 0;
@@ -44,6 +54,9 @@ public:
 	virtual unsigned width() const = 0;
 	virtual unsigned height() const = 0;
 
+	//! IMAGE_MIXED unless the image was analyzed when it was loaded.
+	virtual ImageOpacity opacity() const = 0;
+
 private:
 	Image();
 
@@ -0,0 +1,382 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** jobs.cpp                           **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "client-conf.h"
+#include "formatter.h"
+#include "jobs.h"
+#include "log.h"
+
+class Job
+{
+public:
+	Job(const char* tag, const std::function<void()>& fn)
+		: tag(tag), fn(fn), waitingOn(1), finished(false)
+	{
+	}
+
+	const char* tag;
+	std::function<void()> fn;
+
+	//! Unfinished dependencies, plus one held by Jobs::add() until the
+	//! job's dependencies are all recorded.
+	std::atomic<int> waitingOn;
+
+	std::mutex lock; //!< Guards finished and continuations.
+	bool finished;
+	std::vector<JobRef> continuations;
+};
+
+//! Jobs ready to run, owned by one worker.
+struct WorkQueue
+{
+	std::mutex lock;
+	std::deque<JobRef> jobs;
+};
+
+struct TagProfile
+{
+	TagProfile() : count(0), millis(0.0) {}
+
+	unsigned long count;
+	double millis;
+};
+
+static std::vector<std::thread> workers;
+static std::vector<WorkQueue*> queues;
+
+//! Index of the worker running on this thread, or -1.
+static thread_local int workerIndex = -1;
+
+//! Where the next job queued by a non-worker thread goes.
+static std::atomic<size_t> nextQueue(0);
+
+static std::mutex sleepLock; //!< Guards queued and quitting.
+static std::condition_variable workQueued;
+static std::condition_variable jobFinished;
+static size_t queued = 0;
+static bool quitting = false;
+
+static std::mutex profileLock;
+static std::map<std::string, TagProfile> profile;
+
+static std::mutex mainLock;
+static std::vector<std::function<void()> > mainJobs;
+static std::atomic<bool> mainPending(false);
+
+static void run(const JobRef& job);
+
+static void schedule(const JobRef& job)
+{
+	if (queues.empty()) {
+		// Not started yet, or already stopped.
+		run(job);
+		return;
+	}
+
+	size_t q = workerIndex >= 0 ?
+		(size_t)workerIndex : nextQueue++ % queues.size();
+	{
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		queues[q]->jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queued++;
+	}
+	workQueued.notify_one();
+}
+
+static void release(const JobRef& job)
+{
+	if (--job->waitingOn == 0)
+		schedule(job);
+}
+
+/**
+ * Take a job for worker own to run. Its own newest job is the one most
+ * likely to still be in cache. Failing that, steal another worker's
+ * oldest job, which is the one its owner is least likely to want soon.
+ */
+static JobRef take(int own)
+{
+	JobRef job;
+	size_t n = queues.size();
+
+	if (own >= 0) {
+		WorkQueue* q = queues[(size_t)own];
+		std::lock_guard<std::mutex> guard(q->lock);
+		if (!q->jobs.empty()) {
+			job = q->jobs.back();
+			q->jobs.pop_back();
+		}
+	}
+
+	size_t start = own >= 0 ? (size_t)own + 1 : nextQueue.load();
+	for (size_t i = 0; !job && i < n; i++) {
+		size_t victim = (start + i) % n;
+		if ((int)victim == own)
+			continue;
+		WorkQueue* q = queues[victim];
+		std::lock_guard<std::mutex> guard(q->lock);
+		if (!q->jobs.empty()) {
+			job = q->jobs.front();
+			q->jobs.pop_front();
+		}
+	}
+
+	if (job) {
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queued--;
+	}
+	return job;
+}
+
+static void run(const JobRef& job)
+{
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
+	job->fn();
+	std::chrono::duration<double, std::milli> took =
+		std::chrono::steady_clock::now() - start;
+
+	{
+		std::lock_guard<std::mutex> guard(profileLock);
+		TagProfile& p = profile[job->tag];
+		p.count++;
+		p.millis += took.count();
+	}
+
+	// Let go of anything the function held on to.
+	job->fn = std::function<void()>();
+
+	std::vector<JobRef> next;
+	{
+		std::lock_guard<std::mutex> guard(job->lock);
+		job->finished = true;
+		next.swap(job->continuations);
+	}
+	for (size_t i = 0; i < next.size(); i++)
+		release(next[i]);
+
+	{
+		// Taking the lock orders us after any waiter's last check.
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	jobFinished.notify_all();
+}
+
+static void work(int index)
+{
+	workerIndex = index;
+	while (true) {
+		JobRef job = take(index);
+		if (job) {
+			run(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		while (queued == 0 && !quitting)
+			workQueued.wait(guard);
+		if (queued == 0 && quitting)
+			return;
+	}
+}
+
+void Jobs::init()
+{
+	int n = conf.jobThreads;
+	if (n <= 0)
+		n = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+
+	quitting = false;
+	for (int i = 0; i < n; i++)
+		queues.push_back(new WorkQueue);
+	for (int i = 0; i < n; i++)
+		workers.push_back(std::thread(work, i));
+
+	Log::info("Jobs", Formatter("started % worker threads") % n);
+}
+
+void Jobs::deinit()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		quitting = true;
+	}
+	workQueued.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	for (size_t i = 0; i < queues.size(); i++)
+		delete queues[i];
+	queues.clear();
+
+	std::map<std::string, TagProfile>::iterator it;
+	for (it = profile.begin(); it != profile.end(); it++)
+		Log::info("Jobs", Formatter("%: % jobs in % ms") %
+		          it->first % (long)it->second.count %
+		          it->second.millis);
+	profile.clear();
+}
+
+JobRef Jobs::add(const char* tag, const std::function<void()>& fn,
+                 const std::vector<JobRef>& deps)
+{
+	JobRef job(new Job(tag, fn));
+
+	std::vector<JobRef>::const_iterator it;
+	for (it = deps.begin(); it != deps.end(); it++) {
+		const JobRef& dep = *it;
+		if (!dep)
+			continue;
+		std::lock_guard<std::mutex> guard(dep->lock);
+		if (!dep->finished) {
+			job->waitingOn++;
+			dep->continuations.push_back(job);
+		}
+	}
+
+	release(job);
+	return job;
+}
+
+JobRef Jobs::then(const JobRef& job, const char* tag,
+                  const std::function<void()>& fn)
+{
+	return add(tag, fn, std::vector<JobRef>(1, job));
+}
+
+bool Jobs::finished(const JobRef& job)
+{
+	std::lock_guard<std::mutex> guard(job->lock);
+	return job->finished;
+}
+
+void Jobs::wait(const JobRef& job)
+{
+	while (!finished(job)) {
+		JobRef other = take(workerIndex);
+		if (other) {
+			run(other);
+			continue;
+		}
+
+		// Nothing to help with. The job is running somewhere, or
+		// waiting on one that is.
+		std::unique_lock<std::mutex> guard(sleepLock);
+		if (finished(job))
+			return;
+		jobFinished.wait(guard);
+	}
+}
+
+static void drain(const std::function<void(size_t)>* fn,
+                  std::atomic<size_t>* next, size_t count, size_t grain)
+{
+	size_t begin;
+	while ((begin = next->fetch_add(grain)) < count) {
+		size_t end = std::min(begin + grain, count);
+		for (size_t i = begin; i < end; i++)
+			(*fn)(i);
+	}
+}
+
+void Jobs::parallelFor(const char* tag, size_t count, size_t grain,
+                       const std::function<void(size_t)>& fn)
+{
+	if (count == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+
+	// The calling thread takes a share too.
+	size_t chunks = (count + grain - 1) / grain;
+	size_t helpers = std::min(workers.size(), chunks - 1);
+
+	std::atomic<size_t> next(0);
+	std::vector<JobRef> helping;
+	for (size_t i = 0; i < helpers; i++)
+		helping.push_back(add(tag,
+			std::bind(drain, &fn, &next, count, grain)));
+
+	drain(&fn, &next, count, grain);
+
+	// The helpers point at our stack.
+	for (size_t i = 0; i < helping.size(); i++)
+		wait(helping[i]);
+}
+
+void Jobs::runOnMainThread(const std::function<void()>& fn)
+{
+	std::lock_guard<std::mutex> guard(mainLock);
+	mainJobs.push_back(fn);
+	mainPending = true;
+}
+
+void Jobs::runMainThreadJobs()
+{
+	if (!mainPending)
+		return;
+
+	std::vector<std::function<void()> > fns;
+	{
+		std::lock_guard<std::mutex> guard(mainLock);
+		fns.swap(mainJobs);
+		mainPending = false;
+	}
+
+	// Anything these queue waits for the next update.
+	for (size_t i = 0; i < fns.size(); i++)
+		fns[i]();
+}
+
+bool Jobs::mainThreadJobsPending()
+{
+	return mainPending;
+}
+
+size_t Jobs::threads()
+{
+	return workers.size();
+}
+
+bool Jobs::onWorker()
+{
+	return workerIndex >= 0;
+}
+
@@ -0,0 +1,107 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** jobs.h                             **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Job;
+typedef std::shared_ptr<Job> JobRef;
+
+/**
+ * Runs short pieces of work on a pool of worker threads, so that loading
+ * and background tasks can use every core.
+ *
+ * Each worker has its own queue. Jobs queued from inside a job go on the
+ * back of the worker's own queue, and a worker takes from there first.
+ * A worker that runs out steals from the front of another's. Threads that
+ * wait on a job run queued jobs while they do.
+ *
+ * Jobs run on no particular thread, so they may not touch Gosu, Python or
+ * the World. Hand such work to runOnMainThread(). Jobs must not throw.
+ *
+ * Each job has a tag naming the kind of work it does. Time spent per tag
+ * is logged at exit.
+ */
+class Jobs
+{
+public:
+	//! Start "[engine] jobthreads" workers.
+	static void init();
+
+	//! Finish queued jobs, stop the workers and log the profile.
+	static void deinit();
+
+	/**
+	 * Queue fn to run once every job in deps has finished. tag must
+	 * outlive the job. A string literal is best.
+	 */
+	static JobRef add(const char* tag, const std::function<void()>& fn,
+	                  const std::vector<JobRef>& deps =
+	                  std::vector<JobRef>());
+
+	//! Queue fn to run once job has finished.
+	static JobRef then(const JobRef& job, const char* tag,
+	                   const std::function<void()>& fn);
+
+	//! Wait for job to finish, running other jobs meanwhile.
+	static void wait(const JobRef& job);
+
+	//! Has job finished?
+	static bool finished(const JobRef& job);
+
+	/**
+	 * Call fn(i) for every i in [0, count), spread over the workers and
+	 * the calling thread, and wait for all of them. Each job takes at
+	 * least grain indices at a time.
+	 */
+	static void parallelFor(const char* tag, size_t count, size_t grain,
+	                        const std::function<void(size_t)>& fn);
+
+	//! Run fn at the start of the next update, on the thread that
+	//! updates the World.
+	static void runOnMainThread(const std::function<void()>& fn);
+
+	//! Called by GameWindow at the start of each update.
+	static void runMainThreadJobs();
+
+	//! Is anything waiting for runMainThreadJobs()?
+	static bool mainThreadJobsPending();
+
+	//! Number of worker threads.
+	static size_t threads();
+
+	//! Is this one of the worker threads?
+	static bool onWorker();
+};
+
+#endif
+
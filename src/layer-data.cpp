@@ -0,0 +1,256 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** layer-data.cpp                     **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+
+#include "formatter.h"
+#include "layer-data.h"
+#include "log.h"
+
+typedef std::vector<unsigned char> Bytes;
+
+#define BASE64_SKIP  0x40 // Whitespace.
+#define BASE64_PAD   0x41 // '='
+#define BASE64_BAD   0xFF
+
+//! Value of each base64 digit, or one of the markers above. Filled in
+//! before main(), so it's ready for any thread.
+static struct Base64Values
+{
+	Base64Values()
+	{
+		static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+			"abcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		memset(of, BASE64_BAD, sizeof(of));
+		for (unsigned char i = 0; i < 64; i++)
+			of[(unsigned char)digits[i]] = i;
+		of[(unsigned char)' '] = BASE64_SKIP;
+		of[(unsigned char)'\t'] = BASE64_SKIP;
+		of[(unsigned char)'\r'] = BASE64_SKIP;
+		of[(unsigned char)'\n'] = BASE64_SKIP;
+		of[(unsigned char)'='] = BASE64_PAD;
+	}
+
+	unsigned char of[256];
+} base64Values;
+
+/**
+ * Decode base64 text, ignoring whitespace. Four digits at a time go
+ * through the table into one 24-bit group, so the only branches per group
+ * are for the rare whitespace and the final padding.
+ */
+static bool decodeBase64(const std::string& text, Bytes& out)
+{
+	out.clear();
+	out.reserve(text.size() / 4 * 3);
+
+	const unsigned char* s = (const unsigned char*)text.data();
+	const unsigned char* end = s + text.size();
+
+	unsigned char quad[4];
+	size_t have = 0;
+	size_t padding = 0;
+
+	while (s != end) {
+		unsigned char v = base64Values.of[*s++];
+		if (v < 64) {
+			if (padding)
+				return false; // Digits after '='.
+			quad[have++] = v;
+		}
+		else if (v == BASE64_PAD) {
+			quad[have++] = 0;
+			padding++;
+		}
+		else if (v == BASE64_SKIP)
+			continue;
+		else
+			return false;
+
+		if (have == 4) {
+			uint32_t group = (uint32_t)quad[0] << 18 |
+			                 (uint32_t)quad[1] << 12 |
+			                 (uint32_t)quad[2] << 6 |
+			                 (uint32_t)quad[3];
+			out.push_back((unsigned char)(group >> 16));
+			out.push_back((unsigned char)(group >> 8));
+			out.push_back((unsigned char)group);
+			have = 0;
+		}
+	}
+
+	if (have != 0 || padding > 2)
+		return false;
+	out.resize(out.size() - padding);
+	return true;
+}
+
+//! Inflate zlib or gzip data into exactly out.size() bytes.
+static bool inflateBytes(const Bytes& in, Bytes& out, bool gzip)
+{
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if (inflateInit2(&z, gzip ? 16 + MAX_WBITS : MAX_WBITS) != Z_OK)
+		return false;
+
+	z.next_in = (Bytef*)in.data();
+	z.avail_in = (uInt)in.size();
+	z.next_out = (Bytef*)out.data();
+	z.avail_out = (uInt)out.size();
+
+	int err = inflate(&z, Z_FINISH);
+	inflateEnd(&z);
+	return err == Z_STREAM_END && z.avail_out == 0;
+}
+
+#ifdef HAVE_ZSTD
+static bool unzstdBytes(const Bytes& in, Bytes& out)
+{
+	size_t n = ZSTD_decompress(out.data(), out.size(),
+	                           in.data(), in.size());
+	return !ZSTD_isError(n) && n == out.size();
+}
+#endif
+
+//! Read gids stored as little endian 32-bit integers.
+static void unpackGids(const Bytes& bytes, std::vector<int>& gids)
+{
+	size_t n = bytes.size() / 4;
+	gids.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		const unsigned char* b = &bytes[i * 4];
+		uint32_t gid = (uint32_t)b[0] |
+		               (uint32_t)b[1] << 8 |
+		               (uint32_t)b[2] << 16 |
+		               (uint32_t)b[3] << 24;
+		gids[i] = (int)gid;
+	}
+}
+
+static bool decodeBase64Layer(const std::string& path,
+                              const std::string& compression,
+                              const std::string& text, size_t count,
+                              std::vector<int>& gids)
+{
+	Bytes packed;
+	if (!decodeBase64(text, packed)) {
+		Log::err(path, "layer <data>: invalid base64");
+		return false;
+	}
+
+	if (compression.empty()) {
+		if (packed.size() != count * 4) {
+			Log::err(path, "layer <data>: wrong number of tiles");
+			return false;
+		}
+		unpackGids(packed, gids);
+		return true;
+	}
+
+	Bytes bytes(count * 4);
+	bool ok;
+	if (compression == "zlib" || compression == "gzip")
+		ok = inflateBytes(packed, bytes, compression == "gzip");
+#ifdef HAVE_ZSTD
+	else if (compression == "zstd")
+		ok = unzstdBytes(packed, bytes);
+#endif
+	else {
+		Log::err(path, "layer <data>: unsupported compression: " +
+		         compression);
+		return false;
+	}
+
+	if (!ok) {
+		Log::err(path, Formatter("layer <data>: could not %-decompress "
+		         "% tiles") % compression % (long)count);
+		return false;
+	}
+	unpackGids(bytes, gids);
+	return true;
+}
+
+static bool decodeCSVLayer(const std::string& path, const std::string& text,
+                           size_t count, std::vector<int>& gids)
+{
+	gids.clear();
+	gids.reserve(count);
+
+	const char* s = text.c_str();
+	while (true) {
+		while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+			s++;
+		if (!*s)
+			break;
+
+		char* end;
+		unsigned long gid = strtoul(s, &end, 10);
+		if (end == s || *s == '-') {
+			Log::err(path, "layer <data>: invalid CSV");
+			return false;
+		}
+		gids.push_back((int)(uint32_t)gid);
+
+		s = end;
+		while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+			s++;
+		if (*s == ',')
+			s++;
+		else if (*s) {
+			Log::err(path, "layer <data>: invalid CSV");
+			return false;
+		}
+	}
+
+	if (gids.size() != count) {
+		Log::err(path, "layer <data>: wrong number of tiles");
+		return false;
+	}
+	return true;
+}
+
+bool decodeLayerData(const std::string& path, const std::string& encoding,
+                     const std::string& compression, const std::string& text,
+                     size_t count, std::vector<int>& gids)
+{
+	if (encoding == "base64")
+		return decodeBase64Layer(path, compression, text, count, gids);
+	if (encoding == "csv" && compression.empty())
+		return decodeCSVLayer(path, text, count, gids);
+
+	Log::err(path, "layer <data>: unsupported encoding: " + encoding +
+	         (compression.size() ? " with " + compression : ""));
+	return false;
+}
+
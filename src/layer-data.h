@@ -0,0 +1,52 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** layer-data.h                       **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef LAYER_DATA_H
+#define LAYER_DATA_H
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Read the tile gids from the text of a TMX layer's <data> element, as
+ * Tiled writes it when "Store tile layer data as" is CSV or Base64.
+ *
+ * encoding is "csv" or "base64". Base64 data may be compressed, in which
+ * case compression is "zlib" or "gzip", or "zstd" if built with
+ * HAVE_ZSTD. There must be exactly count gids. Errors are logged under
+ * path.
+ *
+ * Gids with Tiled's flip bits set are out of range and come out negative
+ * or too large, to be rejected as invalid with the rest.
+ */
+bool decodeLayerData(const std::string& path, const std::string& encoding,
+                     const std::string& compression, const std::string& text,
+                     size_t count, std::vector<int>& gids);
+
+#endif
+
@@ -24,11 +24,13 @@
 // IN THE SOFTWARE.
 // **********
 
+#include <functional>
 #include <iostream>
 
 #include <Gosu/Timing.hpp>
 
 #include "client-conf.h"
+#include "jobs.h"
 #include "log.h"
 #include "python.h"
 #include "python-bindings-template.cpp"
@@ -77,6 +79,10 @@ void Log::setVerbosity(verbosity_t v)
 
 void Log::info(std::string domain, std::string msg)
 {
+	if (Jobs::onWorker()) {
+		Jobs::runOnMainThread(std::bind(Log::info, domain, msg));
+		return;
+	}
 	std::string str = ts() + "Info [" + domain + "] - " + chomp(msg);
 	if (verb > V_NORMAL)
 		std::cout << str << std::endl;
@@ -84,6 +90,11 @@ void Log::info(std::string domain, std::string msg)
 
 void Log::err(std::string domain, std::string msg)
 {
+	// Halting, Python and message boxes all belong to the main thread.
+	if (Jobs::onWorker()) {
+		Jobs::runOnMainThread(std::bind(Log::err, domain, msg));
+		return;
+	}
 	if (conf.halting == HALT_ERROR) {
 		Log::fatal(domain, msg);
 		exit(1);
@@ -107,6 +118,10 @@ void Log::err(std::string domain, std::string msg)
 
 void Log::fatal(std::string domain, std::string msg)
 {
+	if (Jobs::onWorker()) {
+		Jobs::runOnMainThread(std::bind(Log::fatal, domain, msg));
+		return;
+	}
 	std::string str = ts() + "Fatal [" + domain + "] - " + chomp(msg);
 	if (inPythonScript) {
 		PyErr_SetString(PyExc_RuntimeError, str.c_str());
@@ -35,6 +35,11 @@ enum verbosity_t {
 	V_VERBOSE  //! Display fatals, errors and info.
 };
 
+/**
+ * Messages logged from a Jobs worker are passed to the main thread and
+ * logged at the start of its next update, since an error may halt the game
+ * or be raised in Python.
+ */
 class Log
 {
 public:
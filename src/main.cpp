@@ -25,6 +25,7 @@
 // **********
 
 #include <iostream>
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -32,6 +33,7 @@
 #include <libxml/parser.h>
 
 #include "client-conf.h"
+#include "jobs.h"
 #include "log.h"
 #include "python.h"
 #include "reader.h"
@@ -61,6 +63,8 @@ struct libraries
 		 */
 		LIBXML_TEST_VERSION
 
+		Jobs::init();
+
 		if (!pythonInit())
 			exit(1);
 
@@ -71,6 +75,8 @@ struct libraries
 
 	~libraries()
 	{
+		// Let loads in flight finish before the cache goes away.
+		Jobs::deinit();
 		Reader::deinit();
 		pythonFinalize();
 		xmlCleanupParser();
@@ -104,13 +110,13 @@ int main(int argc, char** argv)
 	Log::setVerbosity(conf.verbosity);
 	Log::reportVerbosityOnStartup();
 
-	GameWindow window;
+	std::unique_ptr<GameWindow> window(GameWindow::create());
 
 	// Init various libraries we use.
 	libraries libs(argv[0]);
 
-	ASSERT_RETURN1(window.init());
-	window.show();
+	ASSERT_RETURN1(window->init());
+	window->mainLoop();
 	return 0;
 }
 
@@ -198,6 +198,12 @@ void Music::stop()
 	state = NOT_PLAYING;
 }
 
+bool Music::isIdle() const
+{
+	// An intro is polled until it ends so the loop can follow it.
+	return paused || state == NOT_PLAYING || state == PLAYING_LOOP;
+}
+
 void Music::tick()
 {
 	if (paused)
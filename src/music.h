@@ -69,6 +69,9 @@ public:
 	void stop();
 
 	void tick();
+
+	//! Will tick() leave everything as it is until the music is changed?
+	bool isIdle() const;
 	
 	typedef std::shared_ptr<Gosu::Song> SongRef;
 
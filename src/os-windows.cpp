@@ -44,7 +44,7 @@ void wFixConsole()
 void wMessageBox(const std::string& title, const std::string& text)
 {
 	World::instance()->setPaused(true);
-	MessageBox(GameWindow::instance().handle(),
+	MessageBox(GetActiveWindow(),
 		Gosu::widen(text).c_str(),
 		Gosu::widen(title).c_str(),
 		MB_OK
@@ -0,0 +1,283 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** particles.cpp                      **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#include <algorithm>
+
+#include <boost/python.hpp>
+
+#include "area.h"
+#include "particles.h"
+#include "python.h"
+#include "random.h"
+#include "viewport.h"
+
+ParticleEmitter::ParticleEmitter(Area* area, const Viewport* view,
+                                 ImageRef image)
+	: rate(0.0),
+	  lifetime(1.0),
+	  limit(1000),
+	  z(500.0),
+	  followView(false),
+	  area(area),
+	  view(view),
+	  image(image),
+	  running(false),
+	  regionPos(0.0, 0.0),
+	  regionSize(0.0, 0.0),
+	  velocity(0.0, 0.0),
+	  spread(0.0, 0.0),
+	  gravity(0.0, 0.0),
+	  owed(0.0),
+	  drawn(false),
+	  drawnX1(0.0), drawnY1(0.0), drawnX2(0.0), drawnY2(0.0)
+{
+}
+
+void ParticleEmitter::tick(unsigned long dt)
+{
+	size_t n = xs.size();
+	float ms = (float)dt;
+	float secs = ms / 1000.0f;
+	float ax = (float)gravity.x * secs;
+	float ay = (float)gravity.y * secs;
+
+	// Kept as separate loops over single arrays so each vectorizes.
+	float* vx = vxs.data();
+	float* vy = vys.data();
+	for (size_t i = 0; i < n; i++)
+		vx[i] += ax;
+	for (size_t i = 0; i < n; i++)
+		vy[i] += ay;
+
+	float* x = xs.data();
+	float* y = ys.data();
+	for (size_t i = 0; i < n; i++)
+		x[i] += vx[i] * secs;
+	for (size_t i = 0; i < n; i++)
+		y[i] += vy[i] * secs;
+
+	float* age = ages.data();
+	for (size_t i = 0; i < n; i++)
+		age[i] += ms;
+
+	retire();
+
+	if (running) {
+		owed += rate * (double)dt / 1000.0;
+		int due = (int)owed;
+		owed -= due;
+		spawn(due);
+	}
+}
+
+void ParticleEmitter::retire()
+{
+	// Order doesn't matter, so fill holes from the back.
+	size_t i = 0;
+	while (i < xs.size()) {
+		if (ages[i] < lifetimes[i]) {
+			i++;
+			continue;
+		}
+		xs[i] = xs.back();
+		ys[i] = ys.back();
+		vxs[i] = vxs.back();
+		vys[i] = vys.back();
+		ages[i] = ages.back();
+		lifetimes[i] = lifetimes.back();
+		xs.pop_back();
+		ys.pop_back();
+		vxs.pop_back();
+		vys.pop_back();
+		ages.pop_back();
+		lifetimes.pop_back();
+	}
+}
+
+void ParticleEmitter::spawn(int n)
+{
+	n = std::min(n, limit - (int)xs.size());
+	if (n <= 0)
+		return;
+
+	rvec2 origin = regionPos;
+	if (followView)
+		origin = origin + view->getMapOffset();
+
+	for (int i = 0; i < n; i++) {
+		xs.push_back((float)randFloat(origin.x, origin.x + regionSize.x));
+		ys.push_back((float)randFloat(origin.y, origin.y + regionSize.y));
+		vxs.push_back((float)randFloat(velocity.x - spread.x,
+		                               velocity.x + spread.x));
+		vys.push_back((float)randFloat(velocity.y - spread.y,
+		                               velocity.y + spread.y));
+		ages.push_back(0.0f);
+		lifetimes.push_back((float)(lifetime * 1000.0));
+	}
+}
+
+void ParticleEmitter::findDamage()
+{
+	if (xs.empty() && !drawn)
+		return;
+
+	double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
+	if (xs.size()) {
+		x1 = *std::min_element(xs.begin(), xs.end());
+		y1 = *std::min_element(ys.begin(), ys.end());
+		x2 = *std::max_element(xs.begin(), xs.end()) + (double)image->width();
+		y2 = *std::max_element(ys.begin(), ys.end()) + (double)image->height();
+	}
+
+	// One rectangle around the old and new spots. Particles are usually
+	// spread over the whole screen anyway.
+	if (drawn)
+		area->damage(drawnX1, drawnY1, drawnX2, drawnY2);
+	if (xs.size())
+		area->damage(x1, y1, x2, y2);
+
+	drawn = xs.size() != 0;
+	drawnX1 = x1;
+	drawnY1 = y1;
+	drawnX2 = x2;
+	drawnY2 = y2;
+}
+
+void ParticleEmitter::undraw()
+{
+	if (drawn)
+		area->damage(drawnX1, drawnY1, drawnX2, drawnY2);
+	drawn = false;
+}
+
+void ParticleEmitter::detach()
+{
+	area = NULL;
+}
+
+void ParticleEmitter::draw()
+{
+	rvec2 off = view->getMapOffset();
+	rvec2 res = view->getVirtRes();
+	float left = (float)off.x - (float)image->width();
+	float top = (float)off.y - (float)image->height();
+	float right = (float)(off.x + res.x);
+	float bottom = (float)(off.y + res.y);
+
+	Image* img = image.get();
+	for (size_t i = 0; i < xs.size(); i++) {
+		float x = xs[i];
+		float y = ys[i];
+		if (left < x && x < right && top < y && y < bottom)
+			img->draw(x, y, z);
+	}
+}
+
+bool ParticleEmitter::isIdle() const
+{
+	return xs.empty() && (!running || rate <= 0.0);
+}
+
+void ParticleEmitter::burst(int n)
+{
+	spawn(n);
+	if (area)
+		area->requestRedraw();
+}
+
+void ParticleEmitter::clear()
+{
+	xs.clear();
+	ys.clear();
+	vxs.clear();
+	vys.clear();
+	ages.clear();
+	lifetimes.clear();
+	if (area)
+		area->requestRedraw();
+}
+
+int ParticleEmitter::count() const
+{
+	return (int)xs.size();
+}
+
+void ParticleEmitter::setRegion(double x, double y, double w, double h)
+{
+	regionPos = rvec2(x, y);
+	regionSize = rvec2(w, h);
+}
+
+void ParticleEmitter::setVelocity(double x, double y)
+{
+	velocity = rvec2(x, y);
+}
+
+void ParticleEmitter::setSpread(double x, double y)
+{
+	spread = rvec2(x, y);
+}
+
+void ParticleEmitter::setGravity(double x, double y)
+{
+	gravity = rvec2(x, y);
+}
+
+bool ParticleEmitter::isRunning() const
+{
+	return running;
+}
+
+void ParticleEmitter::setRunning(bool running)
+{
+	this->running = running;
+	owed = 0.0;
+}
+
+
+void exportParticles()
+{
+	using namespace boost::python;
+
+	class_<ParticleEmitter, ParticleEmitterRef>
+		("ParticleEmitter", no_init)
+		.def_readwrite("rate", &ParticleEmitter::rate)
+		.def_readwrite("lifetime", &ParticleEmitter::lifetime)
+		.def_readwrite("limit", &ParticleEmitter::limit)
+		.def_readwrite("z", &ParticleEmitter::z)
+		.def_readwrite("follow_view", &ParticleEmitter::followView)
+		.add_property("running", &ParticleEmitter::isRunning,
+		    &ParticleEmitter::setRunning)
+		.add_property("count", &ParticleEmitter::count)
+		.def("set_region", &ParticleEmitter::setRegion)
+		.def("set_velocity", &ParticleEmitter::setVelocity)
+		.def("set_spread", &ParticleEmitter::setSpread)
+		.def("set_gravity", &ParticleEmitter::setGravity)
+		.def("burst", &ParticleEmitter::burst)
+		.def("clear", &ParticleEmitter::clear)
+		;
+}
+
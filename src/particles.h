@@ -0,0 +1,139 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** particles.h                        **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <memory>
+#include <vector>
+
+#include "image.h"
+#include "vec.h"
+
+class Area;
+class Viewport;
+
+/**
+ * Spawns, moves and draws many copies of one Image at a time, for rain,
+ * snow, dust, sparkles and the like. Particles have no scripts, phases or
+ * collision. They fly in a straight line, bent by gravity, until their
+ * lifetime runs out.
+ *
+ * Particles are kept as parallel arrays of floats so that a tick runs as a
+ * handful of simple loops over all of them. All particles share one Image
+ * and one depth, so the Renderer draws them as a single batch.
+ *
+ * Positions are in Area pixels. Speeds are in pixels per second.
+ */
+class ParticleEmitter
+{
+public:
+	ParticleEmitter(Area* area, const Viewport* view, ImageRef image);
+
+	//! Age, move and spawn particles as if dt milliseconds had passed.
+	void tick(unsigned long dt);
+
+	//! Mark where particles were last drawn and where they are now as
+	//! needing to be drawn again.
+	void findDamage();
+
+	//! Mark where particles were last drawn as needing to be drawn
+	//! again, for when the emitter goes away.
+	void undraw();
+
+	//! Forget the Area, for when the emitter leaves it or the Area is
+	//! destroyed. Scripts may still hold the emitter, but it is not
+	//! ticked or drawn again.
+	void detach();
+
+	//! Draw every particle on screen.
+	void draw();
+
+	//! Will tick() change nothing?
+	bool isIdle() const;
+
+	//! Spawn n particles at once.
+	void burst(int n);
+
+	//! Remove every particle.
+	void clear();
+
+	//! Number of particles alive.
+	int count() const;
+
+	//! Rectangle new particles appear in. Relative to the upper-left
+	//! corner of the screen instead of the Area if followView is set.
+	void setRegion(double x, double y, double w, double h);
+
+	//! Speed of new particles, give or take spread in either direction.
+	void setVelocity(double x, double y);
+	void setSpread(double x, double y);
+
+	//! Acceleration applied to every particle.
+	void setGravity(double x, double y);
+
+	bool isRunning() const;
+	void setRunning(bool running);
+
+	// Python properties.
+	double rate; //!< Particles spawned per second while running.
+	double lifetime; //!< Seconds each particle lives.
+	int limit; //!< Most particles alive at once.
+	double z; //!< Depth particles are drawn at.
+	bool followView;
+
+private:
+	void spawn(int n);
+	void retire();
+
+	Area* area;
+	const Viewport* view;
+	ImageRef image;
+	bool running;
+
+	rvec2 regionPos, regionSize;
+	rvec2 velocity, spread, gravity;
+
+	//! Fraction of a particle owed from earlier ticks.
+	double owed;
+
+	// One entry per particle.
+	std::vector<float> xs, ys;
+	std::vector<float> vxs, vys;
+	std::vector<float> ages; //!< Milliseconds lived.
+	std::vector<float> lifetimes; //!< Milliseconds to live.
+
+	// Bounding box last drawn, for damage.
+	bool drawn;
+	double drawnX1, drawnY1, drawnX2, drawnY2;
+};
+
+typedef std::shared_ptr<ParticleEmitter> ParticleEmitterRef;
+
+void exportParticles();
+
+#endif
+
@@ -128,9 +128,9 @@ void Player::moveByTile(ivec2 delta)
 	// down but not to left or right.
 	// --pdm Dec 6, 2014
 	const GameWindow& window = GameWindow::instance();
-	if (window.input().down(Gosu::kbLeftControl)) {
+	if (window.isDown(Gosu::kbLeftControl)) {
 		setPhase(directionStr(facing));
-		redraw = true;
+		requestRedraw();
 		return;
 	}
 
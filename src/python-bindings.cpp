@@ -30,6 +30,7 @@
 #include "entity.h"
 #include "log.h"
 #include "music.h"
+#include "particles.h"
 #include "random.h"
 #include "reader.h"
 #include "script.h"
@@ -46,6 +47,7 @@ BOOST_PYTHON_MODULE(tsunagari)
 	exportEntity();
 	exportLog();
 	exportMusic();
+	exportParticles();
 	exportRandom();
 	exportReader();
 	exportScript();
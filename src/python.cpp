@@ -191,6 +191,31 @@ err:
 	return false;
 }
 
+static PyThreadState* handedOff = NULL;
+static PyGILState_STATE entered;
+
+void pythonHandOff()
+{
+	PyEval_InitThreads();
+	handedOff = PyEval_SaveThread();
+}
+
+void pythonReclaim()
+{
+	PyEval_RestoreThread(handedOff);
+	handedOff = NULL;
+}
+
+void pythonEnter()
+{
+	entered = PyGILState_Ensure();
+}
+
+void pythonLeave()
+{
+	PyGILState_Release(entered);
+}
+
 void pythonFinalize()
 {
 //	Py_DECREF(mainModule);
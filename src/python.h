@@ -43,6 +43,16 @@ void pythonFinalize();
 //! Print last error received within Python.
 void pythonErr();
 
+//! Let another thread run Python. The calling thread may not use it again
+//! until pythonReclaim().
+void pythonHandOff();
+void pythonReclaim();
+
+//! Bracket Python use from a thread other than the one that initialized
+//! it.
+void pythonEnter();
+void pythonLeave();
+
 
 bool pythonPrependPath(const std::string& path);
 bool pythonRmPath(const std::string& path);
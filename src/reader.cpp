@@ -24,24 +24,34 @@
 // IN THE SOFTWARE.
 // **********
 
+#include <chrono>
+#include <deque>
 #include <errno.h>
+#include <exception>
+#include <functional>
+#include <future>
 #include <stdlib.h>
 
 #include <Gosu/Bitmap.hpp>
 #include <Gosu/Image.hpp>
 #include <Gosu/IO.hpp>
+#include <libxml/hash.h>
 #include <map>
+#include <mutex>
 #include <physfs.h>
 
 #include "cache.h"
 #include "cache-template.cpp"
 #include "client-conf.h"
 #include "formatter.h"
+#include "jobs.h"
 #include "log.h"
 #include "python.h"
 #include "python-bindings-template.cpp"
 #include "reader.h"
 #include "script.h"
+#include "string.h"
+#include "validation-cache.h"
 #include "window.h"
 #include "xml.h"
 
@@ -49,6 +59,7 @@
 
 typedef std::shared_ptr<xmlDtd> DTDRef;
 typedef std::shared_ptr<std::string> StringRef;
+typedef std::shared_ptr<Gosu::Buffer> BufferRef;
 
 
 // Caches that store processed, game-ready objects. Garbage collected.
@@ -58,10 +69,33 @@ static Cache<SampleRef> sounds;
 static Cache<XMLRef> xmls;
 static Cache<StringRef> texts;
 
+// Reads finish on other threads. Guards the caches above.
+static std::mutex cachesLock;
+
+//! An asynchronous read waiting for a job to run it.
+struct QueuedRead
+{
+	std::string key;
+	//! Called with the priority the read was run at.
+	std::function<void(ReadPriority)> run;
+};
+
+// Guards the three below.
+static std::mutex readsLock;
+static std::deque<QueuedRead> queuedReads[READ_PRIORITIES_LENGTH];
+//! Futures of reads not yet finished, by key. Each is a std::shared_future
+//! of the type the read's getter returns.
+typedef std::map<std::string, std::shared_ptr<void> > ReadMap;
+static ReadMap readsInFlight;
+
 // DTDs don't expire. No garbage collection.
 typedef std::map<std::string, DTDRef> DTDMap;
 static DTDMap dtds;
 
+//! Hashes of the DTDs' text. Part of the key each document is known by in
+//! ValidationCache, so editing a DTD has its documents checked again.
+static std::map<std::string, uint64_t> dtdHashes;
+
 
 
 static std::string path(const std::string& entryName)
@@ -70,28 +104,38 @@ static std::string path(const std::string& entryName)
 	return conf.worldFilename + "/" + entryName;
 }
 
+//! Report a failed read. A failed prefetch is only worth an info message:
+//! if the file is really needed, whoever needs it reads it again.
+static void readFailed(bool quiet, const std::string& msg)
+{
+	if (quiet)
+		Log::info("Reader", msg);
+	else
+		Log::err("Reader", msg);
+}
+
 template <class T>
-static bool readFromDisk(const std::string& name, T& buf)
+static bool readFromDisk(const std::string& name, T& buf, bool quiet = false)
 {
 	PHYSFS_sint64 size;
 	PHYSFS_File* zf;
 
 	if (!PHYSFS_exists(name.c_str())) {
-		Log::err("Reader", Formatter("%: file missing")
+		readFailed(quiet, Formatter("%: file missing")
 				% path(name));
 		return false;
 	}
 
 	zf = PHYSFS_openRead(name.c_str());
 	if (!zf) {
-		Log::err("Reader", Formatter("%: error opening file: %")
+		readFailed(quiet, Formatter("%: error opening file: %")
 				% path(name) % PHYSFS_getLastError());
 		return false;
 	}
 
 	size = PHYSFS_fileLength(zf);
 	if (size == -1) {
-		Log::err("Reader", Formatter("%: could not determine file size: %")
+		readFailed(quiet, Formatter("%: could not determine file size: %")
 				% path(name) % PHYSFS_getLastError());
 		PHYSFS_close(zf);
 		return false;
@@ -99,13 +143,13 @@ static bool readFromDisk(const std::string& name, T& buf)
 	else if (size > std::numeric_limits<uint32_t>::max()) {
 		// FIXME: Technically, we just need to issue multiple calls to
 		// PHYSFS_read. Fix when needed.
-		Log::err("Reader", Formatter("%: file too long (>4GB)")
+		readFailed(quiet, Formatter("%: file too long (>4GB)")
 				% path(name));
 		PHYSFS_close(zf);
 		return false;
 	}
 	else if (size < -1) {
-		Log::err("Reader", Formatter("%: invalid file size: %")
+		readFailed(quiet, Formatter("%: invalid file size: %")
 				% path(name) % PHYSFS_getLastError());
 		PHYSFS_close(zf);
 		return false;
@@ -119,7 +163,7 @@ static bool readFromDisk(const std::string& name, T& buf)
 
 	if (PHYSFS_read(zf, (char*)(buf.data()),
 			(PHYSFS_uint32)size, 1) != 1) {
-		Log::err("Reader", Formatter("%: error reading file: %")
+		readFailed(quiet, Formatter("%: error reading file: %")
 				% path(name) % PHYSFS_getLastError());
 		PHYSFS_close(zf);
 		return false;
@@ -129,6 +173,20 @@ static bool readFromDisk(const std::string& name, T& buf)
 	return true;
 }
 
+// Deprecated in libxml2 2.12 along with the push-validation calls XMLStream
+// uses. See the note in xml.cpp.
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+static void buildContentModel(void* elem, void* vctxt, const xmlChar*)
+{
+	xmlValidBuildContentModel((xmlValidCtxt*)vctxt, (xmlElement*)elem);
+}
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
 // FIXME: Should be moved to xml.cpp!!!!!!
 static DTDRef parseDTD(const std::string& path)
 {
@@ -146,6 +204,13 @@ static DTDRef parseDTD(const std::string& path)
 	xmlDtd* dtd = xmlIOParseDTD(NULL, input, enc);
 	if (!dtd)
 		return DTDRef();
+	dtdHashes[path] = hashString(bytes);
+
+	// Validation compiles content models on first use, which would write
+	// to a DTD other threads may be validating with. Do it now instead.
+	xmlValidCtxt* vc = xmlNewValidCtxt();
+	xmlHashScan((xmlHashTable*)dtd->elements, buildContentModel, vc);
+	xmlFreeValidCtxt(vc);
 
 	return DTDRef(dtd, xmlFreeDtd);
 }
@@ -166,20 +231,52 @@ static xmlDtd* getDTD(const std::string& name)
 	return it == dtds.end() ? NULL : it->second.get();
 }
 
+//! The archive or directory a file was found in, or "" if there is no such
+//! file.
+static std::string archiveOf(const std::string& name)
+{
+	const char* dir = PHYSFS_getRealDir(name.c_str());
+	return dir ? dir : "";
+}
+
+//! The key a document is known by in ValidationCache.
+static uint64_t validationKey(const std::string& dtdPath,
+                              const std::string& data)
+{
+	std::map<std::string, uint64_t>::const_iterator it =
+		dtdHashes.find(dtdPath);
+	return hashString(data, it == dtdHashes.end() ? HASH_STRING_SEED :
+	                                                it->second);
+}
+
+//! Does a document have to be checked against its DTD? Not if it already
+//! passed, unchanged, unless conf.strictXML asks for every check.
+static bool needsValidation(const std::string& archive, uint64_t key)
+{
+	return conf.strictXML || !ValidationCache::known(archive, key);
+}
+
 static XMLDoc* readXMLDoc(const std::string& name,
-                          const std::string& dtdPath)
+                          const std::string& dtdPath,
+                          const std::string& data)
 {
 	std::string p = path(name);
-	std::string data = Reader::readString(name);
 	xmlDtd* dtd = getDTD(dtdPath);
 
 	if (!dtd || data.empty())
 		return NULL;
+
+	std::string archive = archiveOf(name);
+	uint64_t key = validationKey(dtdPath, data);
+	bool validate = needsValidation(archive, key);
+
 	XMLDoc* doc = new XMLDoc;
-	if (!doc->init(p, data, dtd)) {
+	if (!doc->init(p, data, validate ? dtd : NULL)) {
 		delete doc;
 		return NULL;
 	}
+	if (validate)
+		ValidationCache::add(archive, key);
 	return doc;
 }
 
@@ -235,6 +332,7 @@ bool Reader::init(char* argv0)
 
 void Reader::deinit()
 {
+	ValidationCache::save();
 	PHYSFS_deinit();
 }
 
@@ -293,11 +391,11 @@ bool Reader::fileExists(const std::string& name)
 	return resourceExists(name) && !PHYSFS_isDirectory(name.c_str());
 }
 
-Gosu::Buffer* Reader::readBuffer(const std::string& name)
+static Gosu::Buffer* readBufferFromDisk(const std::string& name, bool quiet)
 {
 	Gosu::Buffer* buf = new Gosu::Buffer();
 
-	if (readFromDisk(name, *buf)) {
+	if (readFromDisk(name, *buf, quiet)) {
 		return buf;
 	}
 	else {
@@ -306,100 +404,419 @@ Gosu::Buffer* Reader::readBuffer(const std::string& name)
 	}
 }
 
+Gosu::Buffer* Reader::readBuffer(const std::string& name)
+{
+	return readBufferFromDisk(name, false);
+}
+
 std::string Reader::readString(const std::string& name)
 {
 	std::string str;
 	return readFromDisk(name, str) ? str : "";
 }
 
-ImageRef Reader::getImage(const std::string& name)
+template <class T>
+static T lifetimeCached(Cache<T>& cache, const std::string& name)
 {
-	ImageRef existing = images.lifetimeRequest(name);
-	if (existing)
-		return existing;
+	std::lock_guard<std::mutex> guard(cachesLock);
+	return cache.lifetimeRequest(name);
+}
+
+template <class T>
+static T momentaryCached(Cache<T>& cache, const std::string& name)
+{
+	std::lock_guard<std::mutex> guard(cachesLock);
+	return cache.momentaryRequest(name);
+}
 
-	std::unique_ptr<Gosu::Buffer> buffer(readBuffer(name));
+/*
+ * Turning file contents into game-ready objects and caching them. Each
+ * takes the buffer Reader::readBuffer() returned, which may be NULL.
+ */
+
+//! Must be run on the main thread.
+static ImageRef makeImage(const std::string& name, const BufferRef& buffer)
+{
 	if (!buffer)
 		return ImageRef();
 
-	ImageRef result(Image::create(buffer->data(), buffer->size()));
+	ImageRef result(Image::create(name, buffer->data(),
+		buffer->size()));
 	if (!result)
 		return ImageRef();
 
+	std::lock_guard<std::mutex> guard(cachesLock);
 	images.lifetimePut(name, result);
 	return result;
 }
 
-TiledImageRef Reader::getTiledImage(const std::string& name,
-		int w, int h)
+//! Safe on any thread.
+static TiledImageRef makeTiledImage(const std::string& name,
+		unsigned w, unsigned h, const BufferRef& buffer)
 {
-	TiledImageRef existing = tiles.momentaryRequest(name);
-	if (existing)
-		return existing;
-
-	if (w <= 0 || h <= 0)
-		return TiledImageRef();
-
-	std::unique_ptr<Gosu::Buffer> buffer(readBuffer(name));
 	if (!buffer)
 		return TiledImageRef();
 
 	TiledImageRef result(
-		TiledImage::create(buffer->data(), buffer->size(),
-			(unsigned int)w, (unsigned int)h)
+		TiledImage::create(name, buffer->data(), buffer->size(), w, h)
 	);
 	if (!result)
 		return TiledImageRef();
 
+	std::lock_guard<std::mutex> guard(cachesLock);
 	tiles.momentaryPut(name, result);
 	return result;
 }
 
+//! Must be run on the main thread.
+static SampleRef makeSample(const std::string& name, const BufferRef& buffer)
+{
+	if (!buffer)
+		return SampleRef();
+
+	SampleRef result(new Sound(new Gosu::Sample(buffer->frontReader())));
+
+	std::lock_guard<std::mutex> guard(cachesLock);
+	sounds.lifetimePut(name, result);
+	return result;
+}
+
+//! Safe on any thread.
+static XMLRef makeXMLDoc(const std::string& name, const std::string& dtdPath,
+		const BufferRef& buffer)
+{
+	XMLRef result;
+	if (buffer)
+		result.reset(readXMLDoc(name, dtdPath, std::string(
+			(const char*)buffer->data(), buffer->size())));
+
+	std::lock_guard<std::mutex> guard(cachesLock);
+	xmls.momentaryPut(name, result);
+	return result;
+}
+
+//! Safe on any thread.
+static std::string makeText(const std::string& name, const BufferRef& buffer)
+{
+	// A failed read isn't cached, so the next getText() tries again. That
+	// way a failed prefetch is still reported as an error if the file turns
+	// out to be needed.
+	if (!buffer)
+		return "";
+
+	StringRef result(new std::string(
+		(const char*)buffer->data(), buffer->size()));
+
+	std::lock_guard<std::mutex> guard(cachesLock);
+	texts.momentaryPut(name, result);
+	return *result;
+}
+
+/*
+ * Asynchronous reads. Each is queued by priority, and one job is added to
+ * the job system per read queued. Whichever read is most urgent when a job
+ * starts is the one it runs, so a read for the Area on screen can overtake
+ * prefetches queued before it.
+ */
+
+//! Run the most urgent queued read.
+static void runQueuedRead()
+{
+	QueuedRead read;
+	ReadPriority priority = READ_VISIBLE;
+	{
+		std::lock_guard<std::mutex> guard(readsLock);
+		for (int p = 0; p < READ_PRIORITIES_LENGTH; p++) {
+			if (queuedReads[p].size()) {
+				read = queuedReads[p].front();
+				queuedReads[p].pop_front();
+				priority = (ReadPriority)p;
+				break;
+			}
+		}
+	}
+	if (read.run)
+		read.run(priority);
+}
+
+//! Move a queued read ahead if it is waiting in a less urgent class.
+//! Called with readsLock held.
+static void promoteRead(const std::string& key, ReadPriority priority)
+{
+	for (int p = priority + 1; p < READ_PRIORITIES_LENGTH; p++) {
+		std::deque<QueuedRead>& queue = queuedReads[p];
+		std::deque<QueuedRead>::iterator it;
+		for (it = queue.begin(); it != queue.end(); it++) {
+			if (it->key == key) {
+				queuedReads[priority].push_back(*it);
+				queue.erase(it);
+				return;
+			}
+		}
+	}
+}
+
+//! Fulfil a read's promise with what finish returns, or with what it
+//! throws.
+template <class T>
+static void settleRead(const std::string& key,
+		const std::shared_ptr<std::promise<T> >& done,
+		const std::function<T()>& finish)
+{
+	try {
+		done->set_value(finish());
+	}
+	catch (...) {
+		done->set_exception(std::current_exception());
+	}
+
+	std::lock_guard<std::mutex> guard(readsLock);
+	readsInFlight.erase(key);
+}
+
+template <class T>
+static void runRead(const std::string& key, const std::string& name,
+		bool onMainThread,
+		const std::function<T(const BufferRef&)>& make,
+		const std::shared_ptr<std::promise<T> >& done,
+		ReadPriority priority)
+{
+	BufferRef buffer(readBufferFromDisk(name,
+		priority == READ_PREFETCH));
+	std::function<T()> finish = std::bind(make, buffer);
+	if (onMainThread)
+		Jobs::runOnMainThread(
+			std::bind(settleRead<T>, key, done, finish));
+	else
+		settleRead<T>(key, done, finish);
+}
+
+/**
+ * Read file name on a worker and pass the contents to make, on the main
+ * thread if onMainThread is set. A request for a key already in flight
+ * shares the first one's future.
+ */
+template <class T>
+static std::shared_future<T> startRead(const std::string& key,
+		const std::string& name, ReadPriority priority,
+		bool onMainThread,
+		const std::function<T(const BufferRef&)>& make)
+{
+	std::shared_ptr<std::shared_future<T> > future;
+	{
+		std::lock_guard<std::mutex> guard(readsLock);
+		ReadMap::iterator it = readsInFlight.find(key);
+		if (it != readsInFlight.end()) {
+			promoteRead(key, priority);
+			return *std::static_pointer_cast<
+				std::shared_future<T> >(it->second);
+		}
+
+		std::shared_ptr<std::promise<T> > done(new std::promise<T>);
+		future.reset(new std::shared_future<T>(done->get_future()));
+		readsInFlight[key] = future;
+
+		QueuedRead read;
+		read.key = key;
+		read.run = std::bind(runRead<T>, key, name, onMainThread,
+		                     make, done, std::placeholders::_1);
+		queuedReads[priority].push_back(read);
+	}
+
+	Jobs::add("read", runQueuedRead);
+	return *future;
+}
+
+/**
+ * If a read for key is in flight, move it to the front and wait for it.
+ * A read that finishes on the main thread must be waited for from there,
+ * with onMainThread set, so that it can be finished while we wait instead
+ * of at the next update.
+ */
+template <class T>
+static bool awaitRead(const std::string& key, T& result,
+		bool onMainThread = false)
+{
+	std::shared_ptr<std::shared_future<T> > future;
+	{
+		std::lock_guard<std::mutex> guard(readsLock);
+		ReadMap::iterator it = readsInFlight.find(key);
+		if (it == readsInFlight.end())
+			return false;
+		promoteRead(key, READ_VISIBLE);
+		future = std::static_pointer_cast<
+			std::shared_future<T> >(it->second);
+	}
+
+	if (onMainThread)
+		while (future->wait_for(std::chrono::milliseconds(1)) !=
+		       std::future_status::ready)
+			Jobs::runMainThreadJobs();
+	result = future->get();
+	return true;
+}
+
+template <class T>
+static std::shared_future<T> ready(const T& value)
+{
+	std::promise<T> done;
+	done.set_value(value);
+	return done.get_future().share();
+}
+
+ImageRef Reader::getImage(const std::string& name)
+{
+	ImageRef existing = lifetimeCached(images, name);
+	if (existing)
+		return existing;
+
+	// A failed prefetch is read again.
+	if (awaitRead("image:" + name, existing, true) && existing)
+		return existing;
+
+	return makeImage(name, BufferRef(readBuffer(name)));
+}
+
+std::shared_future<ImageRef> Reader::getImageAsync(const std::string& name,
+		ReadPriority priority)
+{
+	ImageRef existing = lifetimeCached(images, name);
+	if (existing)
+		return ready(existing);
+
+	return startRead<ImageRef>("image:" + name, name, priority, true,
+		std::bind(makeImage, name, std::placeholders::_1));
+}
+
+TiledImageRef Reader::getTiledImage(const std::string& name,
+		int w, int h)
+{
+	TiledImageRef existing = momentaryCached(tiles, name);
+	if (existing || awaitRead("tiles:" + name, existing))
+		return existing;
+
+	if (w <= 0 || h <= 0)
+		return TiledImageRef();
+
+	return makeTiledImage(name, (unsigned)w, (unsigned)h,
+		BufferRef(readBuffer(name)));
+}
+
+std::shared_future<TiledImageRef> Reader::getTiledImageAsync(
+		const std::string& name, int w, int h, ReadPriority priority)
+{
+	TiledImageRef existing = momentaryCached(tiles, name);
+	if (existing || w <= 0 || h <= 0)
+		return ready(existing);
+
+	return startRead<TiledImageRef>("tiles:" + name, name, priority,
+		false, std::bind(makeTiledImage, name, (unsigned)w,
+		                 (unsigned)h, std::placeholders::_1));
+}
+
 SampleRef Reader::getSample(const std::string& name)
 {
 	if (!conf.audioEnabled)
 		return SampleRef();
 
-	SampleRef existing = sounds.lifetimeRequest(name);
+	SampleRef existing = lifetimeCached(sounds, name);
 	if (existing)
 		return existing;
 
-	std::unique_ptr<Gosu::Buffer> buffer(readBuffer(name));
-	if (!buffer)
-		return SampleRef();
-	SampleRef result(new Sound(new Gosu::Sample(buffer->frontReader())));
+	// A failed prefetch is read again.
+	if (awaitRead("sample:" + name, existing, true) && existing)
+		return existing;
 
-	sounds.lifetimePut(name, result);
-	return result;
+	return makeSample(name, BufferRef(readBuffer(name)));
+}
+
+std::shared_future<SampleRef> Reader::getSampleAsync(const std::string& name,
+		ReadPriority priority)
+{
+	if (!conf.audioEnabled)
+		return ready(SampleRef());
+
+	SampleRef existing = lifetimeCached(sounds, name);
+	if (existing)
+		return ready(existing);
+
+	return startRead<SampleRef>("sample:" + name, name, priority, true,
+		std::bind(makeSample, name, std::placeholders::_1));
 }
 
 XMLRef Reader::getXMLDoc(const std::string& name,
                             const std::string& dtdFile)
 {
-	XMLRef existing = xmls.momentaryRequest(name);
-	if (existing)
+	XMLRef existing = momentaryCached(xmls, name);
+	if (existing || awaitRead("xml:" + name, existing))
 		return existing;
 
-	XMLRef result(readXMLDoc(name, dtdFile));
+	return makeXMLDoc(name, dtdFile, BufferRef(readBuffer(name)));
+}
 
-	xmls.momentaryPut(name, result);
-	return result;
+std::shared_future<XMLRef> Reader::getXMLDocAsync(const std::string& name,
+		const std::string& dtdFile, ReadPriority priority)
+{
+	XMLRef existing = momentaryCached(xmls, name);
+	if (existing)
+		return ready(existing);
+
+	return startRead<XMLRef>("xml:" + name, name, priority, false,
+		std::bind(makeXMLDoc, name, dtdFile, std::placeholders::_1));
+}
+
+XMLStream* Reader::streamXMLDoc(const std::string& name,
+                                const std::string& dtdFile)
+{
+	xmlDtd* dtd = getDTD(dtdFile);
+	std::string data = getText(name);
+	if (!dtd || data.empty())
+		return NULL;
+
+	std::string archive = archiveOf(name);
+	uint64_t key = validationKey(dtdFile, data);
+	bool validate = needsValidation(archive, key);
+
+	XMLStream* stream = new XMLStream;
+	if (!stream->init(path(name), data, validate ? dtd : NULL)) {
+		delete stream;
+		return NULL;
+	}
+	// Only known to be valid if it is read to the end.
+	if (validate)
+		stream->onValid(std::bind(&ValidationCache::add, archive,
+		                          key));
+	return stream;
 }
 
 std::string Reader::getText(const std::string& name)
 {
-	StringRef existing = texts.momentaryRequest(name);
+	StringRef existing = momentaryCached(texts, name);
 	if (existing)
 		return *existing.get();
 
-	StringRef result(new std::string(readString(name)));
+	// An empty result might be a failed prefetch. Read it again.
+	std::string result;
+	if (awaitRead("text:" + name, result) && result.size())
+		return result;
 
-	texts.momentaryPut(name, result);
-	return *result.get();
+	return makeText(name, BufferRef(readBuffer(name)));
+}
+
+std::shared_future<std::string> Reader::getTextAsync(const std::string& name,
+		ReadPriority priority)
+{
+	StringRef existing = momentaryCached(texts, name);
+	if (existing)
+		return ready(*existing.get());
+
+	return startRead<std::string>("text:" + name, name, priority, false,
+		std::bind(makeText, name, std::placeholders::_1));
 }
 
 void Reader::garbageCollect()
 {
+	std::lock_guard<std::mutex> guard(cachesLock);
 	images.garbageCollect();
 	tiles.garbageCollect();
 	sounds.garbageCollect();
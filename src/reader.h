@@ -27,6 +27,7 @@
 #ifndef READER_H
 #define READER_H
 
+#include <future>
 #include <string>
 
 #include <libxml/parser.h>
@@ -42,6 +43,16 @@ namespace Gosu {
 	class Song;
 }
 
+//! How soon an asynchronous read is needed. More urgent reads are started
+//! first.
+enum ReadPriority {
+	//! Needed for the Area on screen, or one about to be.
+	READ_VISIBLE,
+	//! Might be needed later.
+	READ_PREFETCH,
+	READ_PRIORITIES_LENGTH
+};
+
 /**
  * FIXME
  * Provides data and resource extraction for a World.
@@ -49,6 +60,14 @@ namespace Gosu {
  * A Reader object knows how to navigate the data, extract individual
  * requested files, and process the files into data structures. The final data
  * structures are kept in memory for future requests.
+ *
+ * Each getter has an asynchronous variant that reads the file on a worker
+ * thread and returns a future. Requests for a file already being read share
+ * one read. XML documents, text and tiled images are finished on the worker.
+ * Images and sounds need the main thread, so their futures become ready at
+ * the start of the next update and must not be waited on from it. The
+ * blocking getters join a read already in flight instead of starting
+ * another, and finish it early if it needs the main thread.
  */
 class Reader
 {
@@ -70,22 +89,45 @@ public:
 
 	//! Request an image from the World.
 	static ImageRef getImage(const std::string& name);
+	static std::shared_future<ImageRef> getImageAsync(
+		const std::string& name,
+		ReadPriority priority = READ_VISIBLE);
 
 	//! Request an image resource from the World and splits it into a
 	//! number of tiles that each have width and height w by h.
 	static TiledImageRef getTiledImage(const std::string& name,
 		int w, int h);
 
+	//! Start several at once to decode them in parallel.
+	static std::shared_future<TiledImageRef> getTiledImageAsync(
+		const std::string& name, int w, int h,
+		ReadPriority priority = READ_VISIBLE);
+
 	//! Request a sound object from the World. The sound will be
 	//! completely loaded into memory at once.
 	static SampleRef getSample(const std::string& name);
+	static std::shared_future<SampleRef> getSampleAsync(
+		const std::string& name,
+		ReadPriority priority = READ_VISIBLE);
 
 	//! Request an XML document from the World.
 	static XMLRef getXMLDoc(const std::string& name,
 		const std::string& dtdPath);
+	static std::shared_future<XMLRef> getXMLDocAsync(
+		const std::string& name, const std::string& dtdPath,
+		ReadPriority priority = READ_VISIBLE);
+
+	//! Read an XML document from the World one element at a time
+	//! instead of as a whole tree. The caller owns the stream. Only the
+	//! file's text is cached.
+	static XMLStream* streamXMLDoc(const std::string& name,
+		const std::string& dtdPath);
 
 	//! Request a text file from the World.
 	static std::string getText(const std::string& name);
+	static std::shared_future<std::string> getTextAsync(
+		const std::string& name,
+		ReadPriority priority = READ_VISIBLE);
 
 	//! Expunge old resources cached in memory. Decisions on which are
 	//! removed and which are kept are based on the global Conf struct.
@@ -0,0 +1,88 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** renderer.h                         **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+
+//! A rectangle in drawing coordinates.
+struct DamageRect {
+	double x1, y1, x2, y2;
+};
+
+/**
+ * Collects the Image draws made over the course of a frame so that the
+ * backend can sort and batch them before handing them to the graphics card.
+ *
+ * Images at the same depth may be drawn in any order relative to each other
+ * unless a barrier() separates them.
+ */
+class Renderer
+{
+public:
+	static Renderer& instance();
+	virtual ~Renderer();
+
+	//! Throw away the previous frame's draws. Call before drawing.
+	virtual void beginFrame() = 0;
+
+	//! Images drawn after this call will appear above Images drawn before
+	//! it at the same depth.
+	virtual void barrier() = 0;
+
+	/**
+	 * Draw Images into an offscreen target of w by h pixels instead of
+	 * the window, until endOffscreen(). The target is then drawn back as
+	 * a single image, stretched by whatever transform is in effect.
+	 * Returns false, and changes nothing, if the backend can't.
+	 *
+	 * @param x, y the point in current drawing coordinates that becomes
+	 *             the target's upper-left corner
+	 */
+	virtual bool beginOffscreen(double x, double y,
+	                            unsigned w, unsigned h) = 0;
+	virtual void endOffscreen() = 0;
+
+	/**
+	 * Only draw inside rects this frame, keeping the rest of the
+	 * offscreen target as the last frame left it. Call right after
+	 * beginOffscreen(). Returns false if the old contents are gone, as on
+	 * the first frame, after the target has moved, or after a frame that
+	 * drew Images the target couldn't hold, in which case everything has
+	 * to be drawn.
+	 */
+	virtual bool setDamage(const std::vector<DamageRect>& rects) = 0;
+
+private:
+	Renderer();
+
+	friend class RendererImpl;
+};
+
+#endif
+
@@ -240,3 +240,13 @@ std::string itostr(int in)
 	return out.str();
 }
 
+uint64_t hashString(const std::string& s, uint64_t seed)
+{
+	uint64_t hash = seed;
+	for (size_t i = 0; i < s.size(); i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
@@ -27,6 +27,7 @@
 #ifndef STRING_H
 #define STRING_H
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -62,5 +63,12 @@ std::vector<int> parseRanges(const std::string& format);
 //! Convert an integer to a representative string.
 std::string itostr(int in);
 
+#define HASH_STRING_SEED 14695981039346656037ULL
+
+//! 64-bit FNV-1a hash of a string's bytes. The same on every run and every
+//! platform, so it can be saved to disk. Hashing b with a's hash as the seed
+//! gives the hash of a + b.
+uint64_t hashString(const std::string& s, uint64_t seed = HASH_STRING_SEED);
+
 #endif
 
@@ -235,6 +235,12 @@ double Tile::getZ() const
 	return vi.z;
 }
 
+void Tile::setType(TileType* type)
+{
+	TileBase::setType(type);
+	area->tileChanged(*this);
+}
+
 Exit* Tile::getNormalExit() const
 {
 	return exits[EXIT_NORMAL];
@@ -265,22 +271,16 @@ double* Tile::layermodAt(ivec2 dir) const
  * TILETYPE
  */
 TileType::TileType()
-	: TileBase()
+	: TileBase(), animSlot(-1)
 {
 }
 
 TileType::TileType(ImageRef& img)
-	: TileBase()
+	: TileBase(), animSlot(-1)
 {
 	anim = Animation(img);
 }
 
-bool TileType::needsRedraw() const
-{
-	time_t now = World::instance()->time();
-	return anim.needsRedraw(now);
-}
-
 /*
  * TILESET
  */
@@ -314,6 +314,16 @@ TileType* TileSet::get(int x, int y)
 	return types[i];
 }
 
+TileType* TileSet::at(size_t idx)
+{
+	return types[idx];
+}
+
+size_t TileSet::size() const
+{
+	return types.size();
+}
+
 int TileSet::getWidth() const
 {
 	return height;
@@ -370,6 +380,12 @@ void exportTile()
 		.def_readonly("x", &Tile::x)
 		.def_readonly("y", &Tile::y)
 		.add_property("z", &Tile::getZ)
+		.add_property("type",
+		    make_function(
+		      static_cast<TileType* (TileBase::*) () const>
+		        (&TileBase::getType),
+		      return_value_policy<reference_existing_object>()),
+		    &Tile::setType)
 		.add_property("exit",
 		    make_function(
 		      static_cast<Exit* (Tile::*) () const>
@@ -38,93 +38,13 @@ class TileSet;
 #include "animation.h"
 #include "reader.h" // for TiledImage
 #include "script.h"
+#include "tile-flags.h"
 #include "vec.h"
 
 class Area;
 class Entity;
 class TileType;
 
-//! List of possible flags that can be attached to a tile.
-/*!
-	Flags are attached to tiles and denote special behavior for
-	the tile they are bound to.
-
-	see AreaTMX::splitTileFlags().
-*/
-
-/**
- * TILE_NOWALK
- * Neither the player nor NPCs can walk here.
- */
-#define TILE_NOWALK          0x001
-
-/**
- * TILE_NOWALK_PLAYER
- * The player cannot walk here. NPCs can, though.
- */
-#define TILE_NOWALK_PLAYER   0x002
-
-/**
- * TILE_NOWALK_NPC
- * NPCs cannot walk here. The player can, though.
- */
-#define TILE_NOWALK_NPC      0x004
-
-/**
- * TILE_NOWALK_EXIT
- * This Tile is an Exit. Please take appropriate action when entering this Tile,
- * usually by transferring to another Area.
- *
- * This flag is not carried by actual Tiles, but can instead be flipped in an
- * Entity's "exempt" flag which will be read elsewhere in the engine.
- */
-#define TILE_NOWALK_EXIT     0x008
-
-/**
- * TILE_NOWALK_AREA_BOUND
- * This Tile is at the edge of an Area. If you step here, please handle it
- * appropriately.
- *
- * (Usually if one moves off a map bound, one will either transfer to another
- * Area, or will be destroyed.)
- *
- * This flag is not carried by actual Tiles, but can instead be flipped in an
- * Entity's "exempt" flag which will be read elsewhere in the engine.
- */
-#define TILE_NOWALK_AREA_BOUND 0x016
-
-
-/**
- * Types of exits.
- */
-enum ExitDirection {
-	/**
-	 * An Exit that is taken upon arriving at the Tile.
-	 */
-	EXIT_NORMAL,
-	/**
-	 * An Exit that is taken when leaving in the upwards
-	 * direction from a Tile.
-	 */
-	EXIT_UP,
-	/**
-	 * An Exit that is taken when leaving in the downwards
-	 * direction from a Tile.
-	 */
-	EXIT_DOWN,
-	/**
-	 * An Exit that is taken when leaving to the left from
-	 * a Tile.
-	 */
-	EXIT_LEFT,
-	/**
-	 * An Exit that is taken when leaving to the right from
-	 * a Tile.
-	 */
-	EXIT_RIGHT,
-	EXITS_LENGTH
-};
-
 /**
  * Independant object that can manipulate a Tile's flags.
  */
@@ -220,6 +140,10 @@ public:
 
 	double getZ() const;
 
+	//! Change this Tile's type and let the Area know it has to be drawn
+	//! again.
+	void setType(TileType* type);
+
 	Exit* getNormalExit() const;
 	void setNormalExit(Exit exit);
 
@@ -253,12 +177,13 @@ public:
 	TileType();
 	TileType(ImageRef& img);
 
-	//! Returns true if onscreen and we need to update our animation.
-	bool needsRedraw() const;
-
 public:
 	Animation anim; //! Graphics for tiles of this type.
 	std::vector<Tile*> allOfType;
+
+	//! Slot of anim on its Area's AnimationClock, or -1 if it isn't
+	//! animated.
+	int animSlot;
 };
 
 class TileSet
@@ -270,6 +195,8 @@ public:
 	void add(TileType* type);
 	void set(int idx, TileType* type);
 	TileType* get(int x, int y);
+	TileType* at(size_t idx);
+	size_t size() const;
 	int getWidth() const;
 	int getHeight() const;
 
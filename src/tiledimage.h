@@ -28,13 +28,18 @@
 #define TILEDIMAGE_H
 
 #include <memory>
+#include <string>
 
 #include "image.h"
 
 class TiledImage
 {
 public:
-	static TiledImage* create(void* data, size_t length,
+	//! Decode and cut an image. Partial tiles at the right and bottom
+	//! edges are left out. Nothing is uploaded yet, so this may be
+	//! called from any thread. name is only used in logs.
+	static TiledImage* create(const std::string& name,
+			void* data, size_t length,
 			unsigned tileW, unsigned tileH);
 	virtual ~TiledImage();
 
@@ -43,6 +48,15 @@ public:
 	virtual ImageRef& operator[](size_t n) = 0;
 	virtual const ImageRef& operator[](size_t n) const = 0;
 
+	/**
+	 * Keep our textures in video memory, uploading them now if they were
+	 * evicted. Unpinned textures may be evicted to stay under the
+	 * "[cache] videomemory" budget, and come back when drawn. Pins are
+	 * counted.
+	 */
+	virtual void pin() = 0;
+	virtual void unpin() = 0;
+
 private:
 	TiledImage();
 
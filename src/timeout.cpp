@@ -26,6 +26,7 @@
 
 #include <list>
 
+#include "animation.h" // for ANIM_NEVER
 #include "formatter.h"
 #include "python.h"
 #include "python-bindings-template.cpp"
@@ -121,6 +122,18 @@ void updateTimeouts()
 	}
 }
 
+time_t nextTimeout()
+{
+	std::list<Timeout*>::const_iterator it;
+	for (it = timeouts.begin(); it != timeouts.end(); it++) {
+		const Timeout* t = *it;
+		// ready() waits until the clock has passed readyTime().
+		if (t->isActive())
+			return t->readyTime() + 1;
+	}
+	return ANIM_NEVER;
+}
+
 void exportTimeout()
 {
 	using namespace boost::python;
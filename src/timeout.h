@@ -53,6 +53,11 @@ private:
 };
 
 void updateTimeouts();
+
+//! World time at which updateTimeouts() will next run a callback, or
+//! ANIM_NEVER if none are waiting.
+time_t nextTimeout();
+
 void exportTimeout();
 
 #endif
@@ -0,0 +1,853 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** tmx-parser.cpp                     **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "animation.h" // for ANIM_INFINITE_CYCLES
+#include "layer-data.h"
+#include "log.h"
+#include "string.h"
+#include "tile-flags.h"
+#include "tmx-parser.h"
+
+#define ASSERT(x)  if (!(x)) { return false; }
+
+/* NOTE: In the TMX map format used by Tiled, tileset tiles start counting
+         their Y-positions from 0, while layer tiles start counting from 1. I
+         can't imagine why the author did this, but we have to take it into
+         account.
+*/
+
+TMXParser::TMXParser()
+	: area(NULL), gidCount(0)
+{
+}
+
+TMXParser::~TMXParser()
+{
+}
+
+bool TMXParser::parse(const std::string& descriptor, CompiledArea& area)
+{
+	this->descriptor = descriptor;
+	this->area = &area;
+	area = CompiledArea();
+	interned.clear();
+	depth2idx.clear();
+	gidCount = 1; // Tiled's gids start from 1.
+
+	bool ok = processDescriptor();
+	layerLoads.clear();
+	this->area = NULL;
+	return ok;
+}
+
+void TMXParser::prefetchTileSet(const std::string&)
+{
+}
+
+void TMXParser::prefetchTileSetImage(const std::string&, int, int)
+{
+}
+
+void TMXParser::startDecoding(const std::function<void()>& fn)
+{
+	fn();
+}
+
+void TMXParser::finishDecoding()
+{
+}
+
+void TMXParser::addSource(const std::string& name, const std::string& data)
+{
+	CompiledArea::Source source;
+	source.name = name;
+	source.hash = hashString(data);
+	area->sources.push_back(source);
+}
+
+int32_t TMXParser::intern(const std::string& s)
+{
+	std::map<std::string, int32_t>::iterator it = interned.find(s);
+	if (it != interned.end())
+		return it->second;
+
+	int32_t idx = (int32_t)area->strings.size();
+	area->strings.push_back(s);
+	interned[s] = idx;
+	return idx;
+}
+
+bool TMXParser::processDescriptor()
+{
+	std::unique_ptr<XMLStream> stream(streamArea(descriptor));
+	ASSERT(stream);
+	XMLStream& xml = *stream.get();
+
+	ASSERT(xml.nextElement(0) && xml.is("map"));
+	ASSERT(xml.intAttr("width", &area->width));
+	ASSERT(xml.intAttr("height", &area->height));
+
+	/*
+	 * The map is read in one pass, in document order: properties,
+	 * tilesets, then layers and object groups. Tileset images can start
+	 * loading as their tilesets are read. Layers are filled as they are
+	 * read, and encoded ones are handed to startDecoding().
+	 *
+	 * Once the whole map has been read, the tilesets are processed and
+	 * the layers checked against them. Objects are applied last, on top
+	 * of the finished layers.
+	 */
+	std::vector<XMLNode> tilesets, objectGroups;
+	std::vector<int> firstGids;
+	bool ok = true;
+	while (ok && xml.nextElement(1)) {
+		if (xml.is("properties"))
+			ok = processMapProperties(xml.expand());
+		else if (xml.is("tileset")) {
+			XMLNode node = xml.keep();
+			int firstGid = 0;
+			ok = node && node.intAttr("firstgid", &firstGid);
+			std::string source = node.attr("source");
+			if (source.size())
+				// Read external tilesets together.
+				prefetchTileSet(source);
+			else
+				prefetchImages(node);
+			tilesets.push_back(node);
+			firstGids.push_back(firstGid);
+		}
+		else if (xml.is("layer"))
+			ok = processLayer(xml);
+		else if (xml.is("objectgroup"))
+			objectGroups.push_back(xml.keep());
+	}
+	ok = ok && !xml.failed();
+
+	// External tilesets, now that their documents are in. Each is read
+	// in place of the <tileset> that refers to it.
+	std::vector<XMLRef> docs;
+	for (size_t i = 0; ok && i < tilesets.size(); i++) {
+		std::string source = tilesets[i].attr("source");
+		if (source.empty())
+			continue;
+		XMLRef doc = getTileSet(source);
+		if (!doc || !doc->root()) {
+			Log::err(descriptor, source + ": failed to load valid TSX file");
+			ok = false;
+			break;
+		}
+		docs.push_back(doc);
+		tilesets[i] = doc->root(); // <tileset>
+		prefetchImages(tilesets[i]);
+	}
+	for (size_t i = 0; ok && i < tilesets.size(); i++)
+		ok = processTileSet(tilesets[i], firstGids[i]);
+
+	// Decoders point into layerLoads, so wait for them even on failure.
+	finishDecoding();
+	for (size_t i = 0; ok && i < layerLoads.size(); i++)
+		ok = processLayerData(layerLoads[i]);
+	ASSERT(ok);
+
+	for (size_t i = 0; i < objectGroups.size(); i++)
+		ASSERT(processObjectGroup(objectGroups[i]));
+
+	return true;
+}
+
+bool TMXParser::processMapProperties(XMLNode node)
+{
+
+/*
+ <properties>
+  <property name="name" value="Wooded Area"/>
+  <property name="intro_music" value="arrive.ogg"/>
+  <property name="main_music" value="wind.ogg"/>
+  <property name="on_load" value="wood_setup.py"/>
+  <property name="on_focus" value="wood_focus.py"/>
+  <property name="on_tick" value="wood_tick.py"/>
+  <property name="on_turn" value="wood_turn.py"/>
+  <property name="loop" value="xy"/>
+  <property name="color_overlay" value="255,255,255,127"/>
+ </properties>
+*/
+
+	for (XMLNode child = node.childrenNode(); child; child = child.next()) {
+		std::string name = child.attr("name");
+		std::string value = child.attr("value");
+		if (name == "name")
+			area->name = intern(value);
+		else if (name == "intro_music")
+			area->introMusic = intern(value);
+		else if (name == "main_music")
+			area->loopMusic = intern(value);
+		else if (name == "on_load")
+			area->loadScript = intern(value);
+		else if (name == "on_focus")
+			area->focusScript = intern(value);
+		else if (name == "on_tick")
+			area->tickScript = intern(value);
+		else if (name == "on_turn")
+			area->turnScript = intern(value);
+		else if (name == "loop") {
+			area->loopX = value.find('x') != std::string::npos;
+			area->loopY = value.find('y') != std::string::npos;
+		}
+		else if (name == "color_overlay") {
+			ASSERT(parseRGBA(value, &area->colorOverlay));
+			area->hasColorOverlay = 1;
+		}
+	}
+	return true;
+}
+
+void TMXParser::prefetchImages(XMLNode node)
+{
+	// Errors are left for processTileSet() to report.
+	int tilex = atoi(node.attr("tilewidth").c_str());
+	int tiley = atoi(node.attr("tileheight").c_str());
+	for (XMLNode img = node.childrenNode(); img; img = img.next())
+		if (img.is("image"))
+			prefetchTileSetImage(img.attr("source"), tilex, tiley);
+}
+
+bool TMXParser::processTileSet(XMLNode node, int firstGid)
+{
+
+/*
+ <tileset firstgid="1" name="tiles.sheet" tilewidth="64" tileheight="64">
+  <image source="tiles.sheet" width="256" height="256"/>
+  <tile id="14">
+   ...
+  </tile>
+ </tileset>
+*/
+
+	int tilex, tiley;
+	int tiles = 0;
+
+	ASSERT(node.intAttr("tilewidth", &tilex));
+	ASSERT(node.intAttr("tileheight", &tiley));
+	if (tilex <= 0 || tiley <= 0) {
+		Log::err(descriptor, "<tileset> has no size");
+		return false;
+	}
+
+	if (area->tileWidth && (area->tileWidth != tilex ||
+	                        area->tileHeight != tiley)) {
+		Log::err(descriptor,
+			"<tileset>'s width/height contradict earlier <layer>");
+		return false;
+	}
+	area->tileWidth = tilex;
+	area->tileHeight = tiley;
+
+	for (XMLNode child = node.childrenNode(); child; child = child.next()) {
+		if (child.is("image")) {
+			int pixelw, pixelh;
+			ASSERT(child.intAttr("width", &pixelw) &&
+			       child.intAttr("height", &pixelh));
+
+			CompiledArea::TileSet set;
+			set.image = intern(child.attr("source"));
+			// Rounded down, as TiledImage cuts the image.
+			set.width = pixelw / tilex;
+			set.height = pixelh / tiley;
+			area->tileSets.push_back(set);
+
+			tiles = set.width * set.height;
+			gidCount += tiles;
+		}
+		else if (child.is("tile")) {
+			// Handle an explicitly declared "non-vanilla" type.
+
+			if (area->tileSets.empty()) {
+				Log::err(descriptor,
+				  "Tile type processed before tileset image loaded");
+				return false;
+			}
+
+			// "id" is 0-based index of a tile in the current
+			// tileset, if the tileset were a flat array.
+			CompiledArea::TileType type;
+			type.tileSet = (int32_t)area->tileSets.size() - 1;
+			ASSERT(child.intAttr("id", &type.id));
+			if (type.id < 0 || tiles <= type.id) {
+				Log::err(descriptor, "tile type id is invalid");
+				return false;
+			}
+
+			// "gid" is the global area-wide id of the tile.
+			type.gid = type.id + firstGid;
+			if (gidCount <= type.gid) {
+				Log::err(descriptor, "tileset's firstgid is wrong");
+				return false;
+			}
+			ASSERT(processTileType(child, type, tiles));
+			area->tileTypes.push_back(type);
+		}
+	}
+
+	return true;
+}
+
+bool TMXParser::processTileType(XMLNode node, CompiledArea::TileType& type,
+		int tiles)
+{
+
+/*
+  <tile id="8">
+   <properties>
+    <property name="flags" value="nowalk"/>
+    <property name="onEnter" value="skid();speed(2)"/>
+    <property name="onLeave" value="undo()"/>
+    <property name="onUse" value="undo()"/>
+   </properties>
+  </tile>
+  <tile id="14">
+   <properties>
+    <property name="frames" value="1,2,3,4"/>
+    <property name="speed" value="2"/>
+   </properties>
+  </tile>
+*/
+
+	type.flags = 0;
+	type.enterScript = type.leaveScript = type.useScript = NO_STRING;
+	type.frameLen = -1;
+	type.cycles = ANIM_INFINITE_CYCLES;
+
+	XMLNode child = node.childrenNode(); // <properties>
+	for (child = child.childrenNode(); child; child = child.next()) {
+		// Each <property>...
+		std::string name = child.attr("name");
+		std::string value = child.attr("value");
+		if (name == "flags") {
+			ASSERT(splitTileFlags(value, &type.flags));
+		}
+		else if (name == "on_enter")
+			type.enterScript = intern(value);
+		else if (name == "on_leave")
+			type.leaveScript = intern(value);
+		else if (name == "on_use")
+			type.useScript = intern(value);
+		else if (name == "frames") {
+			std::vector<std::string> frames = splitStr(value, ",");
+
+			// Make sure the first member is this tile.
+			if (frames.empty() || atoi(frames[0].c_str()) != type.id) {
+				Log::err(descriptor, "first member of tile"
+					" id " + itostr(type.id) +
+					" animation must be itself.");
+				return false;
+			}
+
+			for (size_t i = 0; i < frames.size(); i++) {
+				int idx = atoi(frames[i].c_str());
+				if (idx < 0 || tiles <= idx) {
+					Log::err(descriptor, "frame index out "
+						"of range for animated tile");
+					return false;
+				}
+				type.frames.push_back(idx);
+			}
+		}
+		else if (name == "speed") {
+			double hertz;
+			ASSERT(child.doubleAttr("value", &hertz));
+			type.frameLen = (int)(1000.0/hertz);
+		}
+		else if (name == "cycles") {
+			ASSERT(child.intAttr("value", &type.cycles));
+		}
+	}
+
+	// If a Tile is animated, it needs both member frames and a speed.
+	if (type.frames.empty() != (type.frameLen == -1)) {
+		Log::err(descriptor, "tile type must either have both "
+			"frames and speed or none");
+		return false;
+	}
+
+	return true;
+}
+
+void TMXParser::allocateMapLayer(double depth)
+{
+	size_t size = (size_t)(area->width * area->height);
+	area->gids.resize(area->gids.size() + size);
+	area->flags.resize(area->flags.size() + size);
+	area->depths.push_back(depth);
+	area->depth++;
+}
+
+bool TMXParser::processLayer(XMLStream& xml)
+{
+
+/*
+ <layer name="Tiles0" width="5" height="5">
+  <properties>
+   ...
+  </properties>
+  <data>
+   <tile gid="9"/>
+   <tile gid="9"/>
+   <tile gid="9"/>
+...
+   <tile gid="3"/>
+   <tile gid="9"/>
+   <tile gid="9"/>
+  </data>
+ </layer>
+*/
+
+	int x, y;
+	ASSERT(xml.intAttr("width", &x));
+	ASSERT(xml.intAttr("height", &y));
+
+	if (area->width != x || area->height != y) {
+		Log::err(descriptor, "layer x,y size != map x,y size");
+		return false;
+	}
+
+	allocateMapLayer((double)NAN);
+
+	while (xml.nextElement(2)) {
+		if (xml.is("properties")) {
+			ASSERT(processLayerProperties(xml.expand()));
+		}
+		else if (xml.is("data")) {
+			ASSERT(readLayerData(xml));
+		}
+	}
+	ASSERT(!xml.failed());
+
+	if (isnan(area->depths.back())) {
+		Log::err(descriptor, "<layer> must have layer property");
+		return false;
+	}
+	return true;
+}
+
+bool TMXParser::processLayerProperties(XMLNode node)
+{
+
+/*
+  <properties>
+   <property name="layer" value="0"/>
+  </properties>
+*/
+
+	for (XMLNode child = node.childrenNode(); child; child = child.next()) {
+		std::string name = child.attr("name");
+		if (name == "layer") {
+			double depth;
+			ASSERT(child.doubleAttr("value", &depth));
+			if (depth2idx.find(depth) != depth2idx.end()) {
+				Log::err(descriptor,
+				         "depth used multiple times");
+				return false;
+			}
+
+			depth2idx[depth] = area->depth - 1;
+			area->depths.back() = depth;
+		}
+	}
+	return true;
+}
+
+bool TMXParser::readLayerData(XMLStream& xml)
+{
+	layerLoads.push_back(LayerLoad());
+	LayerLoad& load = layerLoads.back();
+	load.z = area->depth - 1;
+	load.ok = false;
+
+	// Encoded text may be decoded on another thread while we read on.
+	load.encoding = xml.attr("encoding");
+	if (load.encoding.size()) {
+		load.compression = xml.attr("compression");
+		load.text = xml.text();
+		startDecoding(std::bind(&TMXParser::decodeLayer, this, &load));
+		return !xml.failed();
+	}
+
+	// Otherwise the gids are taken straight off the <tile> elements as
+	// they stream past.
+	load.tiles.reserve((size_t)(area->width * area->height));
+	while (xml.nextElement(3)) {
+		int gid;
+		ASSERT(xml.intAttr("gid", &gid));
+		load.tiles.push_back(gid);
+	}
+	load.ok = !xml.failed();
+	return load.ok;
+}
+
+void TMXParser::decodeLayer(LayerLoad* load)
+{
+	// May run on a worker. Touches nothing but *load.
+	load->ok = decodeLayerData(descriptor, load->encoding,
+		load->compression, load->text,
+		(size_t)(area->width * area->height), load->tiles);
+	std::string().swap(load->text);
+}
+
+bool TMXParser::processLayerData(const LayerLoad& load)
+{
+	ASSERT(load.ok);
+
+	size_t count = (size_t)(area->width * area->height);
+	if (load.tiles.size() > count) {
+		Log::err(descriptor, "too many tiles in <layer>");
+		return false;
+	}
+
+	// A gid of zero means there is no tile at this position on this
+	// layer.
+	size_t start = (size_t)load.z * count;
+	for (size_t i = 0; i < load.tiles.size(); i++) {
+		int gid = load.tiles[i];
+		if (gid < 0 || gidCount <= gid) {
+			Log::err(descriptor, "invalid tile gid");
+			return false;
+		}
+		area->gids[start + i] = gid;
+	}
+	return true;
+}
+
+bool TMXParser::processObjectGroup(XMLNode node)
+{
+
+/*
+ <objectgroup name="Prop0" width="5" height="5">
+  <properties>
+   <property name="layer" value="0.0"/>
+  </properties>
+  <object name="tile2" gid="7" x="64" y="320">
+   <properties>
+    <property name="onEnter" value="speed(0.5)"/>
+    <property name="onLeave" value="undo()"/>
+    <property name="onUse" value="undo()"/>
+    <property name="exit" value="grassfield.area,1,1,0"/>
+    <property name="flags" value="npc_nowalk"/>
+   </properties>
+  </object>
+ </objectgroup>
+*/
+
+	int x, y;
+	ASSERT(node.intAttr("width", &x));
+	ASSERT(node.intAttr("height", &y));
+
+	double depth = (double)NAN;
+
+	if (area->width != x || area->height != y) {
+		Log::err(descriptor, "objectgroup x,y size != map x,y size");
+		return false;
+	}
+
+	for (XMLNode child = node.childrenNode(); child; child = child.next()) {
+		if (child.is("properties")) {
+			ASSERT(processObjectGroupProperties(child, &depth));
+		}
+		else if (child.is("object")) {
+			ASSERT(!isnan(depth));
+			ASSERT(processObject(child, depth2idx[depth]));
+		}
+	}
+
+	return true;
+}
+
+bool TMXParser::processObjectGroupProperties(XMLNode node, double* depth)
+{
+
+/*
+  <properties>
+   <property name="layer" value="0.0"/>
+  </properties>
+*/
+
+	bool layerFound = false;
+
+	for (XMLNode child = node.childrenNode(); child; child = child.next()) {
+		std::string name = child.attr("name");
+		if (name == "layer") {
+			layerFound = true;
+			ASSERT(child.doubleAttr("value", depth));
+			if (depth2idx.find(*depth) == depth2idx.end()) {
+				allocateMapLayer(*depth);
+				depth2idx[*depth] = area->depth - 1;
+			}
+		}
+	}
+
+	if (!layerFound)
+		Log::err(descriptor, "<objectgroup> must have layer property");
+	return layerFound;
+}
+
+bool TMXParser::processObject(XMLNode node, int z)
+{
+
+/*
+  <object name="tile2" gid="7" x="64" y="320">
+   <properties>
+    <property name="onEnter" value="speed(0.5)"/>
+    <property name="onLeave" value="undo()"/>
+    <property name="onUse" value="undo()"/>
+    <property name="exit" value="grassfield.area,1,1,0"/>
+    <property name="flags" value="npc_nowalk"/>
+   </properties>
+  </object>
+  <object name="foo" x="0" y="0" width="64" height="64">
+   ...
+  </object>
+*/
+
+	// Gather object properties now. Assign them to tiles later.
+	CompiledArea::ScriptRegion scripts;
+	scripts.enterScript = scripts.leaveScript = scripts.useScript =
+		NO_STRING;
+	std::vector<CompiledArea::ExitRegion> exits;
+	std::vector<CompiledArea::LayermodRegion> layermods;
+	uint32_t flags = 0x0;
+
+	XMLNode child = node.childrenNode(); // <properties>
+	if (!child) {
+		// Empty <object> element. Odd, but acceptable.
+		return true;
+	}
+	for (child = child.childrenNode(); child; child = child.next()) {
+		// Each <property>...
+		std::string name = child.attr("name");
+		std::string value = child.attr("value");
+
+		// "exit:up" and the like name a direction after the colon.
+		std::string base = name.substr(0, name.find(':'));
+		std::string suffix = name.size() > base.size() ?
+			name.substr(base.size() + 1) : "";
+		int dir = -1;
+		if (suffix == "")
+			dir = EXIT_NORMAL;
+		else if (suffix == "up")
+			dir = EXIT_UP;
+		else if (suffix == "down")
+			dir = EXIT_DOWN;
+		else if (suffix == "left")
+			dir = EXIT_LEFT;
+		else if (suffix == "right")
+			dir = EXIT_RIGHT;
+
+		if (name == "flags") {
+			ASSERT(splitTileFlags(value, &flags));
+		}
+		else if (name == "on_enter")
+			scripts.enterScript = intern(value);
+		else if (name == "on_leave")
+			scripts.leaveScript = intern(value);
+		else if (name == "on_use")
+			scripts.useScript = intern(value);
+		else if (base == "exit" && dir != -1) {
+			CompiledArea::ExitRegion exit;
+			exit.dir = dir;
+			ASSERT(parseExit(value, exit));
+			exits.push_back(exit);
+			if (dir == EXIT_NORMAL)
+				flags |= TILE_NOWALK_NPC;
+		}
+		else if (base == "layermod" && dir != -1) {
+			CompiledArea::LayermodRegion layermod;
+			layermod.dir = dir;
+			ASSERT(child.doubleAttr("value", &layermod.mod));
+			layermods.push_back(layermod);
+			if (dir == EXIT_NORMAL)
+				flags |= TILE_NOWALK_NPC;
+		}
+	}
+
+	// Apply these properties directly to one or more tiles in a rectangle
+	// of the map.
+	CompiledArea::Region r;
+	ASSERT(node.intAttr("x", &r.x));
+	ASSERT(node.intAttr("y", &r.y));
+	r.x /= area->tileWidth;
+	r.y /= area->tileHeight;
+	r.z = z;
+
+	if (node.hasAttr("gid")) {
+		// This is one of Tiled's "Tile Objects". It is one tile wide
+		// and high.
+
+		// Bug in tiled. The y is off by one. The author of the format
+		// knows about this, but it will not change.
+		r.y = r.y - 1;
+		r.w = 1;
+		r.h = 1;
+
+		// We don't actually use the object gid. It is supposed to
+		// indicate which tile our object is rendered as, but for
+		// Tsunagari, tile objects are always transparent and reveal
+		// the tile below.
+	}
+	else {
+		// This is one of Tiled's "Objects". It has a width and height.
+		ASSERT(node.intAttr("width", &r.w));
+		ASSERT(node.intAttr("height", &r.h));
+		r.w /= area->tileWidth;
+		r.h /= area->tileHeight;
+	}
+
+	if (r.x < 0 || r.w < 0 || area->width < r.x + r.w ||
+	    r.y < 0 || r.h < 0 || area->height < r.y + r.h) {
+		Log::err(descriptor, "<object> is outside the map");
+		return false;
+	}
+
+	for (int y = r.y; y < r.y + r.h; y++)
+		for (int x = r.x; x < r.x + r.w; x++)
+			area->flags[((size_t)z * (size_t)area->height +
+			             (size_t)y) * (size_t)area->width +
+			            (size_t)x] |= flags;
+
+	if (scripts.enterScript != NO_STRING ||
+	    scripts.leaveScript != NO_STRING ||
+	    scripts.useScript != NO_STRING) {
+		scripts.r = r;
+		area->scripts.push_back(scripts);
+	}
+	for (size_t i = 0; i < exits.size(); i++) {
+		exits[i].r = r;
+		area->exits.push_back(exits[i]);
+	}
+	for (size_t i = 0; i < layermods.size(); i++) {
+		layermods[i].r = r;
+		area->layermods.push_back(layermods[i]);
+	}
+
+	return true;
+}
+
+bool TMXParser::splitTileFlags(const std::string& strOfFlags,
+		uint32_t* flags)
+{
+	std::vector<std::string> strs = splitStr(strOfFlags, ",");
+
+	for (size_t i = 0; i < strs.size(); i++) {
+		const std::string& str = strs[i];
+		if (str == "nowalk")
+			*flags |= TILE_NOWALK;
+		else if (str == "nowalk_player")
+			*flags |= TILE_NOWALK_PLAYER;
+		else if (str == "nowalk_npc")
+			*flags |= TILE_NOWALK_NPC;
+		else {
+			Log::err(descriptor, "invalid tile flag: " + str);
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Matches regex /\s*\d+\+?/
+ */
+static bool isIntegerOrPlus(const std::string& s)
+{
+	size_t i = 0;
+	while (i < s.size() && isspace(s[i]))
+		i++;
+	while (i < s.size() && isdigit(s[i]))
+		i++;
+	return i == s.size() || (s[i] == '+' && i + 1 == s.size());
+}
+
+bool TMXParser::parseExit(const std::string& dest,
+		CompiledArea::ExitRegion& exit)
+{
+
+/*
+  Format: destination area, x, y, z
+  E.g.:   "babysfirst.area,1,3,0"
+*/
+
+	std::vector<std::string> strs = splitStr(dest, ",");
+
+	if (strs.size() != 4 ||
+	    !isIntegerOrPlus(strs[1]) ||
+	    !isIntegerOrPlus(strs[2]) ||
+	    !isIntegerOrPlus(strs[3])) {
+		Log::err(descriptor, "<exit />: invalid format");
+		return false;
+	}
+
+	exit.area = intern(strs[0]);
+	exit.x = atoi(strs[1].c_str());
+	exit.y = atoi(strs[2].c_str());
+	exit.z = atof(strs[3].c_str());
+	exit.wwide = strs[1].find('+') != std::string::npos;
+	exit.hwide = strs[2].find('+') != std::string::npos;
+	return true;
+}
+
+bool TMXParser::parseRGBA(const std::string& str, uint32_t* argb)
+{
+	std::vector<std::string> strs = splitStr(str, ",");
+
+	if (strs.size() != 4) {
+		Log::err(descriptor, "invalid RGBA format");
+		return false;
+	}
+
+	uint32_t channels[4];
+	for (int i = 0; i < 4; i++) {
+		std::string s = strs[i];
+		if (!isInteger(s)) {
+			Log::err(descriptor, "invalid RGBA format");
+			return false;
+		}
+		int v = atoi(s.c_str());
+		if (!(0 <= v && v < 256)) {
+			Log::err(descriptor,
+				"RGBA values must be between 0 and 255");
+			return false;
+		}
+		channels[i] = (uint32_t)v;
+	}
+
+	*argb = channels[3] << 24 | channels[0] << 16 |
+	        channels[1] << 8 | channels[2];
+	return true;
+}
+
@@ -0,0 +1,132 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** tmx-parser.h                       **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef TMX_PARSER_H
+#define TMX_PARSER_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "compiled-area.h"
+#include "xml.h"
+
+/**
+ * Reads an Area's TMX file, and the TSX files it uses, into a CompiledArea.
+ * Everything is checked as it is read. AreaTMX builds an Area from the
+ * result, and tsunagari-compile writes it out for AreaBinary.
+ *
+ * Where the files come from is up to the subclass. Hooks let it start work
+ * early, like loading tileset images, while the map is still being read.
+ */
+class TMXParser
+{
+public:
+	TMXParser();
+	virtual ~TMXParser();
+
+	//! Read the Area in descriptor into area. Logs and returns false
+	//! if it is unreadable or invalid.
+	bool parse(const std::string& descriptor, CompiledArea& area);
+
+protected:
+	//! Open a TMX file, checked against dtd/area.dtd.
+	virtual XMLStream* streamArea(const std::string& name) = 0;
+	//! Read a TSX file, checked against dtd/tsx.dtd.
+	virtual XMLRef getTileSet(const std::string& name) = 0;
+
+	//! A TSX file will be asked for once the map has been read.
+	virtual void prefetchTileSet(const std::string& name);
+	//! A tileset image will be needed, split into tiles of w by h.
+	virtual void prefetchTileSetImage(const std::string& name,
+		int w, int h);
+	//! Run fn, which decodes a layer's text, now or on another thread.
+	//! Runs it now unless overridden.
+	virtual void startDecoding(const std::function<void()>& fn);
+	//! Wait for everything startDecoding() was given.
+	virtual void finishDecoding();
+
+	//! Note a file the Area is read from, so that a compiled copy can
+	//! tell when it is out of date.
+	void addSource(const std::string& name, const std::string& data);
+
+private:
+	//! A <layer>'s tile gids. The <data> may be a <tile> element per
+	//! tile, read as the map streams past, or CSV or base64 text, decoded
+	//! by startDecoding().
+	struct LayerLoad
+	{
+		int z;
+		std::string encoding, compression, text;
+		std::vector<int> tiles;
+		bool ok;
+	};
+
+	//! Index of a string in the Area's string table.
+	int32_t intern(const std::string& s);
+
+	bool processDescriptor();
+	bool processMapProperties(XMLNode node);
+	void prefetchImages(XMLNode node);
+	bool processTileSet(XMLNode node, int firstGid);
+	bool processTileType(XMLNode node, CompiledArea::TileType& type,
+			int tiles);
+	bool processLayer(XMLStream& xml);
+	bool processLayerProperties(XMLNode node);
+	bool readLayerData(XMLStream& xml);
+	void decodeLayer(LayerLoad* load);
+	bool processLayerData(const LayerLoad& load);
+	bool processObjectGroup(XMLNode node);
+	bool processObjectGroupProperties(XMLNode node, double* depth);
+	bool processObject(XMLNode node, int z);
+	bool splitTileFlags(const std::string& strOfFlags, uint32_t* flags);
+	bool parseExit(const std::string& dest,
+		CompiledArea::ExitRegion& exit);
+	bool parseRGBA(const std::string& str, uint32_t* argb);
+
+	//! Add a layer of empty Tiles.
+	void allocateMapLayer(double depth);
+
+	std::string descriptor;
+	CompiledArea* area;
+	std::map<std::string, int32_t> interned;
+	std::map<double, int> depth2idx;
+
+	//! Gids handed out to tileset tiles so far, counting 0.
+	int32_t gidCount;
+
+	//! Layers read so far. A deque, so that decoders' pointers survive
+	//! more being added.
+	std::deque<LayerLoad> layerLoads;
+};
+
+#endif
+
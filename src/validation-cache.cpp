@@ -0,0 +1,134 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** validation-cache.cpp               **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "formatter.h"
+#include "log.h"
+#include "validation-cache.h"
+
+//! First line of a saved list. Lists with any other are ignored.
+#define VALIDATION_CACHE_HEADER "tsunagari valid xml 1"
+
+//! Documents known to be valid in one archive.
+struct KnownValid
+{
+	KnownValid() : loaded(false), changed(false) {}
+
+	std::set<uint64_t> hashes;
+	bool loaded;  //!< Its saved list has been read.
+	bool changed; //!< Has hashes the saved list lacks.
+};
+
+// Documents are read on job threads, too. Guards archives.
+static std::mutex archivesLock;
+static std::map<std::string, KnownValid> archives;
+
+static void load(const std::string& archive, KnownValid& known)
+{
+	std::string path = archive + VALIDATION_CACHE_SUFFIX;
+	std::ifstream in(path.c_str());
+	std::string line;
+	if (!in || !std::getline(in, line) || line != VALIDATION_CACHE_HEADER)
+		return;
+
+	while (std::getline(in, line)) {
+		char* end;
+		unsigned long long hash = strtoull(line.c_str(), &end, 16);
+		if (line.size() && *end == '\0')
+			known.hashes.insert((uint64_t)hash);
+	}
+	Log::info(path, Formatter("% documents known valid")
+		% (long)known.hashes.size());
+}
+
+//! The list for archive, read from disk if it hasn't been yet. Must be
+//! called with archivesLock held.
+static KnownValid& knownIn(const std::string& archive)
+{
+	KnownValid& known = archives[archive];
+	if (!known.loaded) {
+		known.loaded = true;
+		load(archive, known);
+	}
+	return known;
+}
+
+bool ValidationCache::known(const std::string& archive, uint64_t hash)
+{
+	if (archive.empty())
+		return false;
+
+	std::lock_guard<std::mutex> guard(archivesLock);
+	return knownIn(archive).hashes.count(hash) != 0;
+}
+
+void ValidationCache::add(const std::string& archive, uint64_t hash)
+{
+	if (archive.empty())
+		return;
+
+	std::lock_guard<std::mutex> guard(archivesLock);
+	KnownValid& known = knownIn(archive);
+	if (known.hashes.insert(hash).second)
+		known.changed = true;
+}
+
+void ValidationCache::save()
+{
+	std::lock_guard<std::mutex> guard(archivesLock);
+
+	std::map<std::string, KnownValid>::iterator it;
+	for (it = archives.begin(); it != archives.end(); it++) {
+		KnownValid& known = it->second;
+		if (!known.changed)
+			continue;
+
+		std::string path = it->first + VALIDATION_CACHE_SUFFIX;
+		std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+		out << VALIDATION_CACHE_HEADER << "\n";
+		std::set<uint64_t>::const_iterator hash;
+		for (hash = known.hashes.begin(); hash != known.hashes.end();
+		     hash++) {
+			char buf[17];
+			snprintf(buf, sizeof(buf), "%016llx",
+			         (unsigned long long)*hash);
+			out << buf << "\n";
+		}
+		out.close();
+		if (!out)
+			Log::info(path, "could not save");
+		else
+			known.changed = false;
+	}
+}
+
@@ -0,0 +1,61 @@
+/***************************************
+** Tsunagari Tile Engine              **
+** validation-cache.h                 **
+** Copyright 2011-2013 PariahSoft LLC **
+***************************************/
+
+// **********
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+// **********
+
+
+#ifndef VALIDATION_CACHE_H
+#define VALIDATION_CACHE_H
+
+#include <stdint.h>
+#include <string>
+
+//! Added to an archive's path to name the file its list is saved in.
+#define VALIDATION_CACHE_SUFFIX ".valid"
+
+/**
+ * Remembers which XML documents have passed validation against their DTD,
+ * so that a document read again unchanged need not be checked again.
+ * Documents are known by a hash of their text and of their DTD's, so an
+ * edit to either makes them be checked anew.
+ *
+ * Each archive has its own list. It is read from a file next to the archive
+ * the first time it is needed, and written back by save().
+ */
+class ValidationCache
+{
+public:
+	//! Has the document with this hash from archive passed before?
+	static bool known(const std::string& archive, uint64_t hash);
+
+	//! The document with this hash from archive has passed.
+	static void add(const std::string& archive, uint64_t hash);
+
+	//! Write out the lists that have grown. Archives that can't be
+	//! written next to are skipped.
+	static void save();
+};
+
+#endif
+
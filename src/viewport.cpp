@@ -24,7 +24,6 @@
 // IN THE SOFTWARE.
 // **********
 
-#include <Gosu/Graphics.hpp> // for Gosu::screenWidth/Height()
 #include <Gosu/Math.hpp>
 
 #include "area.h"
@@ -39,9 +38,6 @@ Viewport::Viewport(icoord vsize)
 	  mode(TM_MANUAL),
 	  area(NULL)
 {
-	double width = (double)Gosu::screenWidth();
-	double height = (double)Gosu::screenHeight();
-	aspectRatio = width / height;
 }
 
 Viewport::~Viewport()
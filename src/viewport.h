@@ -94,7 +94,6 @@ private:
 		TM_FOLLOW_ENTITY
 	};
 
-	double aspectRatio;
 	rvec2 off;
 	rvec2 virtRes;
 
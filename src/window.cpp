@@ -24,12 +24,13 @@
 // IN THE SOFTWARE.
 // **********
 
-#include <Gosu/Graphics.hpp> // for Gosu::Graphics
-#include <Gosu/Timing.hpp>
-#include <Gosu/Utility.hpp>
+#include <algorithm>
+#include <chrono>
 
 #include "client-conf.h"
+#include "jobs.h"
 #include "reader.h"
+#include "renderer.h"
 #include "world.h"
 #include "window.h"
 
@@ -38,16 +39,14 @@
 // Garbage collection called every X milliseconds
 #define GC_CALL_PERIOD 10 * 1000
 
-namespace Gosu {
-	/**
-	 * Enable 1980s-style graphics scaling: nearest-neighbor filtering.
-	 * Call this function before creating any Gosu::Image.
-	 */
-	void enableUndocumentedRetrofication() {
-		extern bool undocumentedRetrofication;
-		undocumentedRetrofication = true;
-	}
-}
+// Longest garbage collection is put off while frames are running long.
+#define GC_MAX_DELAY 60 * 1000
+
+// Milliseconds each frame gets. Gosu's default update interval.
+#define FRAME_BUDGET (1000.0 / 60.0)
+
+typedef std::chrono::steady_clock steady;
+typedef std::chrono::duration<double, std::milli> millis;
 
 static GameWindow* globalWindow = NULL;
 
@@ -57,21 +56,12 @@ GameWindow& GameWindow::instance()
 }
 
 GameWindow::GameWindow()
-	// Gosu emulates the requested screen resolution on fullscreen,
-	// but this breaks our aspect ratio-correcting letterbox.
-	// Ergo we just make a window the size of the screen.
-	: Gosu::Window(
-	    conf.fullscreen ? Gosu::screenWidth() :
-	                      (unsigned)conf.windowSize.x,
-	    conf.fullscreen ? Gosu::screenHeight() :
-	                      (unsigned)conf.windowSize.y,
-	    conf.fullscreen
-	  ),
-	  now(Gosu::milliseconds()),
-	  lastGCtime(0)
+	: now(0),
+	  lastGCtime(0),
+	  governor(FRAME_BUDGET, conf.maxFrameSkip),
+	  skipDraw(false)
 {
 	globalWindow = this;
-	Gosu::enableUndocumentedRetrofication();
 }
 
 GameWindow::~GameWindow()
@@ -84,22 +74,12 @@ bool GameWindow::init()
 	return world->init();
 }
 
-int GameWindow::width() const
-{
-	return (int)graphics().width();
-}
-
-int GameWindow::height() const
-{
-	return (int)graphics().height();
-}
-
 void GameWindow::buttonDown(const Gosu::Button btn)
 {
-	now = (int)Gosu::milliseconds();
+	now = readClock();
 	if (btn == Gosu::kbEscape &&
-			(input().down(Gosu::kbLeftShift) ||
-			 input().down(Gosu::kbRightShift))) {
+			(isDown(Gosu::kbLeftShift) ||
+			 isDown(Gosu::kbRightShift))) {
 		exit(0);
 	}
 	else {
@@ -125,26 +105,63 @@ void GameWindow::buttonUp(const Gosu::Button btn)
 
 void GameWindow::draw()
 {
+	steady::time_point start = steady::now();
+	Renderer::instance().beginFrame();
 	world->draw();
+	governor.drew(millis(steady::now() - start).count());
 }
 
 bool GameWindow::needsRedraw() const
 {
-	return world->needsRedraw();
+	return !skipDraw && world->needsRedraw();
 }
 
 void GameWindow::update()
 {
-	now = Gosu::milliseconds();
+	steady::time_point start = steady::now();
+	now = readClock();
+
+	Jobs::runMainThreadJobs();
 
 	if (conf.moveMode == TURN)
 		handleKeyboardInput(now);
 	world->update(now);
 
-	if (now > lastGCtime + GC_CALL_PERIOD) {
+	// Garbage collection can wait for a lull, within reason.
+	if (now > lastGCtime + GC_CALL_PERIOD &&
+	    (governor.hasHeadroom() || now > lastGCtime + GC_MAX_DELAY)) {
 		lastGCtime = now;
 		Reader::garbageCollect();
 	}
+
+	governor.updated(millis(steady::now() - start).count());
+	skipDraw = world->needsRedraw() && governor.skipDraw();
+}
+
+time_t GameWindow::idleTime() const
+{
+	if (Jobs::mainThreadJobsPending())
+		return 0;
+
+	time_t idle = world->idleTime();
+
+	// Held keys repeat on their own in TURN mode.
+	if (conf.moveMode == TURN) {
+		std::map<Gosu::Button, keystate>::const_iterator it;
+		for (it = keystates.begin(); it != keystates.end(); it++) {
+			const keystate& state = it->second;
+			if (!state.initiallyResolved)
+				return 0;
+
+			time_t delay = state.consecutive ?
+			    conf.persistCons : conf.persistInit;
+			time_t repeat = state.since + delay;
+			idle = std::min(idle, repeat > now ? repeat - now : 0);
+		}
+	}
+
+	time_t gc = lastGCtime + GC_CALL_PERIOD;
+	return std::min(idle, gc > now ? gc - now : 0);
 }
 
 time_t GameWindow::time() const
@@ -152,6 +169,11 @@ time_t GameWindow::time() const
 	return now;
 }
 
+bool GameWindow::hasHeadroom() const
+{
+	return governor.hasHeadroom();
+}
+
 void GameWindow::handleKeyboardInput(time_t now)
 {
 	std::map<Gosu::Button, keystate>::iterator it;
@@ -31,11 +31,11 @@
 #include <memory>
 #include <string>
 
-#include <Gosu/Window.hpp> // for Gosu::Window
+#include <Gosu/Input.hpp> // for Gosu::Button
+#include <Gosu/Color.hpp>
+#include <Gosu/Graphics.hpp> // for Gosu::Transform
 
-namespace Gosu {
-	class Button;
-}
+#include "governor.h"
 
 class World;
 
@@ -43,14 +43,18 @@ class World;
 /*!
 	This class is structurally the main class of the Tsunagari Tile Engine.
 	It handles input and drawing.
+
+	The window itself, and the graphics and input behind it, are provided
+	by a backend through GameWindow::create(). The backend calls back into
+	buttonDown(), buttonUp(), update(), needsRedraw() and draw().
 */
-class GameWindow : public Gosu::Window
+class GameWindow
 {
 public:
 	static GameWindow& instance();
 
-	//! GameWindow Constructor
-	GameWindow();
+	//! Create the backend's window.
+	static GameWindow* create();
 
 	//! GameWindow Destructor
 	virtual ~GameWindow();
@@ -59,30 +63,62 @@ public:
 	bool init();
 
 	//! Width of the window in pixels.
-	int width() const;
+	virtual int width() const = 0;
 
 	//! Height of the window in pixels.
-	int height() const;
+	virtual int height() const = 0;
+
+	virtual void setCaption(const std::string& caption) = 0;
+
+	//! Run the game until the window is closed.
+	virtual void mainLoop() = 0;
+
+	//! Is the button being held down?
+	virtual bool isDown(Gosu::Button btn) const = 0;
+
+	//! Draw a solid rectangle.
+	virtual void drawRect(double x1, double x2, double y1, double y2,
+	                      Gosu::Color c, double z) = 0;
+
+	//! Only draw inside the given rectangle until popClip().
+	virtual void pushClip(double x, double y, double w, double h) = 0;
+	virtual void popClip() = 0;
 
-	//! Gosu Callback
+	//! Transform everything drawn until popTransform().
+	virtual void pushTransform(const Gosu::Transform& t) = 0;
+	virtual void popTransform() = 0;
+
+	//! Backend Callback
 	void buttonDown(const Gosu::Button btn);
 
-	//! Gosu Callback
+	//! Backend Callback
 	void buttonUp(const Gosu::Button btn);
 
-	//! Gosu Callback
+	//! Backend Callback
 	void draw();
 
-	//! Gosu Callback
+	//! Backend Callback
 	bool needsRedraw() const;
 
-	//! Gosu Callback
+	//! Backend Callback
 	void update();
 
+	//! Backend Callback. Milliseconds until update() next has work to do
+	//! unless input arrives first. A backend may sleep through them.
+	time_t idleTime() const;
+
 	//! Time since epoch.
 	time_t time() const;
 
+	//! Are frames cheap enough right now to run work that could wait?
+	bool hasHeadroom() const;
+
 protected:
+	GameWindow();
+
+	//! Read the backend's clock, in milliseconds.
+	virtual time_t readClock() const = 0;
+
 	//! Process persistent keyboard input
 	void handleKeyboardInput(time_t now);
 
@@ -91,6 +127,9 @@ protected:
 	time_t now;
 	time_t lastGCtime;
 
+	Governor governor;
+	bool skipDraw;
+
 	struct keystate {
 		bool consecutive, initiallyResolved;
 		time_t since;
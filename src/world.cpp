@@ -24,12 +24,17 @@
 // IN THE SOFTWARE.
 // **********
 
+#include <algorithm>
+#include <math.h>
+
 #include <Gosu/Image.hpp>
 #include <Gosu/Utility.hpp>
 
+#include "area-binary.h"
 #include "area-tmx.h"
 #include "client-conf.h"
 #include "log.h"
+#include "renderer.h"
 #include "music.h"
 #include "python.h"
 #include "python-bindings-template.cpp"
@@ -48,7 +53,7 @@ World* World::instance()
 }
 
 World::World()
-	: total(0), redraw(false), userPaused(false), paused(0)
+	: area(NULL), total(0), redraw(false), userPaused(false), paused(0)
 {
 	globalWorld = this;
 	lastTime = GameWindow::instance().time();
@@ -133,19 +138,31 @@ void World::draw()
 	redraw = false;
 
 	GameWindow& window = GameWindow::instance();
-	Gosu::Graphics& graphics = window.graphics();
 
 	int clips = pushLetterbox();
-	graphics.pushTransform(getTransform());
+	window.pushTransform(getTransform());
+
+	// With upscaling on, the Area is drawn once at its virtual resolution
+	// and the result stretched to the window, so pixels drawn don't grow
+	// with the size of the monitor.
+	Renderer& renderer = Renderer::instance();
+	rvec2 scroll = view->getMapOffset();
+	rvec2 res = view->getVirtRes();
+	bool offscreen = conf.upscale && renderer.beginOffscreen(
+		scroll.x, scroll.y,
+		(unsigned)ceil(res.x), (unsigned)ceil(res.y));
 
 	area->draw();
 
-	graphics.popTransform();
+	if (offscreen)
+		renderer.endOffscreen();
+
+	window.popTransform();
 	popLetterbox(clips);
 
 	if (paused) {
-		unsigned ww = graphics.width();
-		unsigned wh = graphics.height();
+		unsigned ww = (unsigned)window.width();
+		unsigned wh = (unsigned)window.height();
 		Gosu::Color darken(127, 0, 0, 0);
 		double top = std::numeric_limits<double>::max();
 
@@ -180,6 +197,19 @@ void World::update(time_t now)
 	}
 }
 
+time_t World::idleTime() const
+{
+	if (redraw)
+		return 0;
+	if (paused)
+		return ANIM_NEVER;
+
+	time_t next = std::min(nextTimeout(), area->nextChange());
+	if (next == ANIM_NEVER)
+		return ANIM_NEVER;
+	return next > total ? next - total : 0;
+}
+
 void World::tick(unsigned long dt)
 {
 	updateTimeouts();
@@ -200,10 +230,21 @@ Area* World::getArea(const std::string& filename)
 	if (entry != areas.end())
 		return entry->second;
 
-	Area* newArea = new AreaTMX(view.get(), &player, filename);
-
-	if (!newArea->init())
+	// A compiled copy of the Area, if there is an up to date one, saves
+	// parsing the TMX. If the copy cannot be used after all, fall back to
+	// the TMX it was compiled from.
+	Area* newArea = AreaBinary::open(view.get(), &player, filename);
+	if (newArea && !newArea->init()) {
+		Log::info("World", filename + ": compiled copy unusable, "
+			"loading TMX");
+		delete newArea;
 		newArea = NULL;
+	}
+	if (!newArea) {
+		newArea = new AreaTMX(view.get(), &player, filename);
+		if (!newArea->init())
+			newArea = NULL;
+	}
 	areas[filename] = newArea;
 	return newArea;
 }
@@ -220,6 +261,8 @@ void World::focusArea(Area* area, int x, int y, double z)
 
 void World::focusArea(Area* area, vicoord playerPos)
 {
+	if (this->area && this->area != area)
+		this->area->unfocus();
 	this->area = area;
 	player.setArea(area);
 	player.setTileCoords(playerPos);
@@ -296,13 +339,12 @@ time_t World::calculateDt(time_t now)
 int World::pushLetterbox()
 {
 	GameWindow& w = GameWindow::instance();
-	Gosu::Graphics& g = w.graphics();
 
 	// Aspect ratio correction.
 	rvec2 sz = view->getPhysRes();
 	rvec2 lb = -1 * view->getLetterboxOffset();
 
-	g.beginClipping(lb.x, lb.y, sz.x - 2 * lb.x, sz.y - 2 * lb.y);
+	w.pushClip(lb.x, lb.y, sz.x - 2 * lb.x, sz.y - 2 * lb.y);
 	int clips = 1;
 
 	// Map bounds.
@@ -317,12 +359,12 @@ int World::pushLetterbox()
 
 	if (!loopX && physScroll.x > 0) {
 		// Boxes on left-right.
-		g.beginClipping(physScroll.x, 0, sz.x - 2 * physScroll.x, sz.x);
+		w.pushClip(physScroll.x, 0, sz.x - 2 * physScroll.x, sz.x);
 		clips++;
 	}
 	if (!loopY && physScroll.y > 0) {
 		// Boxes on top-bottom.
-		g.beginClipping(0, physScroll.y, sz.x, sz.y - 2 * physScroll.y);
+		w.pushClip(0, physScroll.y, sz.x, sz.y - 2 * physScroll.y);
 		clips++;
 	}
 
@@ -333,20 +375,14 @@ void World::popLetterbox(int clips)
 {
 	GameWindow& w = GameWindow::instance();
 	for (; clips; clips--)
-		w.graphics().endClipping();
+		w.popClip();
 }
 
 void World::drawRect(double x1, double x2, double y1, double y2,
                        Gosu::Color c, double z)
 {
 	GameWindow& window = GameWindow::instance();
-	window.graphics().drawQuad(
-		x1, y1, c,
-		x2, y1, c,
-		x2, y2, c,
-		x1, y2, c,
-		z
-	);
+	window.drawRect(x1, x2, y1, y2, c, z);
 }
 
 Gosu::Transform World::getTransform()
@@ -401,7 +437,7 @@ bool World::processInfo(XMLNode node)
 	for (node = node.childrenNode(); node; node = node.next()) {
 		if (node.is("name")) {
 			name = node.content();
-			GameWindow::instance().setCaption(Gosu::widen(name));
+			GameWindow::instance().setCaption(name);
 		} else if (node.is("author")) {
 			author = node.content();
 		} else if (node.is("version")) {
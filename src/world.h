@@ -97,6 +97,13 @@ public:
 
 	void update(time_t now);
 
+	/**
+	 * Milliseconds that can pass before update() has anything to do, if
+	 * no input arrives in the meantime. Zero if it has work now, and
+	 * ANIM_NEVER if only input can wake it.
+	 */
+	time_t idleTime() const;
+
 	/**
 	 * Updates the game state within this World as if dt milliseconds had
 	 * passed since the last call.
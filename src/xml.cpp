@@ -39,19 +39,19 @@ XMLNode::XMLNode()
 {
 }
 
-XMLNode::XMLNode(XMLDoc* doc, xmlNode* node)
-	: doc(doc), node(node)
+XMLNode::XMLNode(const std::string* path, xmlNode* node)
+	: path(path), node(node)
 {
 }
 
 XMLNode XMLNode::childrenNode() const
 {
-	return XMLNode(doc, node->xmlChildrenNode);
+	return XMLNode(path, node->xmlChildrenNode);
 }
 
 XMLNode XMLNode::next() const
 {
-	return XMLNode(doc, node->next);
+	return XMLNode(path, node->next);
 }
 
 bool XMLNode::is(const char* name) const
@@ -71,7 +71,7 @@ bool XMLNode::intContent(int* i) const
 {
 	std::string s = content();
 	if (!isInteger(s)) {
-		Log::err(doc->path(), "expected integer");
+		Log::err(*path, "expected integer");
 		return false;
 	}
 	*i = atoi(s.c_str());
@@ -82,7 +82,7 @@ bool XMLNode::doubleContent(double *d) const
 {
 	std::string s = content();
 	if (!isDecimal(s)) {
-		Log::err(doc->path(), "expected decimal");
+		Log::err(*path, "expected decimal");
 		return false;
 	}
 	*d = atof(s.c_str());
@@ -106,7 +106,7 @@ bool XMLNode::intAttr(const std::string& name, int* i) const
 {
 	std::string s = attr(name);
 	if (!isInteger(s)) {
-		Log::err(doc->path(), "expected integer");
+		Log::err(*path, "expected integer");
 		return false;
 	}
 	*i = atoi(s.c_str());
@@ -117,7 +117,7 @@ bool XMLNode::doubleAttr(const std::string& name, double* d) const
 {
 	std::string s = attr(name);
 	if (!isDecimal(s)) {
-		Log::err(doc->path(), "expected decimal");
+		Log::err(*path, "expected decimal");
 		return false;
 	}
 	*d = atof(s.c_str());
@@ -167,6 +167,9 @@ bool XMLDoc::init(const std::string& path,
 		return false;
 	}
 
+	if (!dtd)
+		return true;
+
 	// Assert the document is sane.
 	xmlValidCtxt* vc = xmlNewValidCtxt();
 	int valid = xmlValidateDtd(vc, doc.get(), dtd);
@@ -183,7 +186,7 @@ bool XMLDoc::init(const std::string& path,
 
 XMLNode XMLDoc::root()
 {
-	return XMLNode(this, xmlDocGetRootElement(doc.get()));
+	return XMLNode(&path_, xmlDocGetRootElement(doc.get()));
 }
 
 xmlNode* XMLDoc::temporaryGetRoot() const
@@ -211,3 +214,324 @@ long XMLDoc::use_count() const
 	return doc.use_count();
 }
 
+
+static void readerErrorCb(void* pstrFilename, const char* msg,
+                          xmlParserSeverities, xmlTextReaderLocatorPtr)
+{
+	const std::string* filename = (const std::string*)pstrFilename;
+	std::string s = msg;
+	while (s.size() && s[s.size() - 1] == '\n')
+		s.erase(s.size() - 1);
+	Log::err(*filename, s);
+}
+
+XMLStream::XMLStream()
+	: dtd(NULL), reader(NULL), valid(NULL), dtdDoc(NULL),
+	  unread(false), expanded(false), bad(false)
+{
+}
+
+XMLStream::~XMLStream()
+{
+	for (size_t i = 0; i < kept.size(); i++)
+		xmlFreeNode(kept[i]);
+	if (reader)
+		xmlFreeTextReader(reader);
+	if (valid)
+		xmlFreeValidCtxt(valid);
+	if (dtdDoc) {
+		// The DTD is shared, and not ours to free.
+		dtdDoc->extSubset = NULL;
+		xmlFreeDoc(dtdDoc);
+	}
+}
+
+bool XMLStream::init(const std::string& path,
+                     const std::string& data,
+                     xmlDtd* dtd)
+{
+	this->path_ = path;
+	this->data = data;
+	this->dtd = dtd;
+
+	reader = xmlReaderForMemory(this->data.c_str(), (int)this->data.size(),
+		NULL, NULL, XML_PARSE_NOBLANKS | XML_PARSE_NONET);
+	if (!reader) {
+		Log::err(path, "could not parse file");
+		return false;
+	}
+	xmlTextReaderSetErrorHandler(reader, readerErrorCb, (void*)&path_);
+
+	if (!dtd)
+		return true;
+
+	dtdDoc = xmlNewDoc(BAD_CAST("1.0"));
+	dtdDoc->extSubset = dtd;
+
+	valid = xmlNewValidCtxt();
+	valid->userData = (void*)&path_;
+	valid->error = xmlErrorCb;
+	return true;
+}
+
+void XMLStream::onValid(std::function<void()> fn)
+{
+	whenValid = fn;
+}
+
+bool XMLStream::nextElement(int depth)
+{
+	while (true) {
+		if (unread)
+			unread = false;
+		else if (!advance())
+			return false;
+
+		int d = xmlTextReaderDepth(reader);
+		int type = xmlTextReaderNodeType(reader);
+		if (d < depth) {
+			// Out of the parent. Its end tag is ours to read past,
+			// anything else is for whoever reads at that depth.
+			unread = !(type == XML_READER_TYPE_END_ELEMENT &&
+			           d == depth - 1);
+			return false;
+		}
+		if (d == depth && type == XML_READER_TYPE_ELEMENT)
+			return true;
+	}
+}
+
+bool XMLStream::is(const char* name) const
+{
+	const xmlChar* n = xmlTextReaderConstName(reader);
+	return n && !xmlStrcmp(n, BAD_CAST(name));
+}
+
+std::string XMLStream::attr(const std::string& name) const
+{
+	xmlChar* content = xmlTextReaderGetAttribute(reader,
+		BAD_CAST(name.c_str()));
+	std::string s = content ? (const char*)content : "";
+	xmlFree(content);
+	return s;
+}
+
+bool XMLStream::intAttr(const std::string& name, int* i) const
+{
+	std::string s = attr(name);
+	if (!isInteger(s)) {
+		Log::err(path_, "expected integer");
+		return false;
+	}
+	*i = atoi(s.c_str());
+	return true;
+}
+
+XMLNode XMLStream::expand()
+{
+	xmlNode* node = xmlTextReaderExpand(reader);
+	if (!node) {
+		bad = true;
+		return XMLNode(&path_, NULL);
+	}
+
+	// The reader won't visit what's inside, so check it here. An empty
+	// element was already checked when it was read.
+	if (dtd && !expanded && !xmlTextReaderIsEmptyElement(reader)) {
+		for (xmlNode* child = node->children; child; child = child->next)
+			if (!checkTree(child))
+				bad = true;
+		if (!popElement(node))
+			bad = true;
+		if (xmlTextReaderDepth(reader) == 0)
+			endRoot();
+	}
+	expanded = true;
+	return XMLNode(&path_, node);
+}
+
+XMLNode XMLStream::keep()
+{
+	XMLNode node = expand();
+	if (!node)
+		return node;
+
+	xmlNode* copy = xmlDocCopyNode(xmlTextReaderCurrentNode(reader),
+	                               NULL, 1);
+	kept.push_back(copy);
+	return XMLNode(&path_, copy);
+}
+
+std::string XMLStream::text()
+{
+	XMLNode node = expand();
+	return node ? node.content() : "";
+}
+
+bool XMLStream::failed() const
+{
+	return bad;
+}
+
+const std::string& XMLStream::path() const
+{
+	return path_;
+}
+
+//! Read the next node and check it against the DTD.
+bool XMLStream::advance()
+{
+	if (bad)
+		return false;
+
+	// An expanded element's insides were checked by expand().
+	int result = expanded ? xmlTextReaderNext(reader) :
+	                        xmlTextReaderRead(reader);
+	expanded = false;
+	if (result != 1) {
+		bad = result < 0;
+		return false;
+	}
+
+	if (!dtd)
+		return true;
+
+	xmlNode* node = xmlTextReaderCurrentNode(reader);
+	switch (xmlTextReaderNodeType(reader)) {
+	case XML_READER_TYPE_ELEMENT:
+		if (!pushElement(node))
+			bad = true;
+		else if (xmlTextReaderIsEmptyElement(reader)) {
+			if (!popElement(node))
+				bad = true;
+			else if (xmlTextReaderDepth(reader) == 0)
+				endRoot();
+		}
+		break;
+	case XML_READER_TYPE_END_ELEMENT:
+		if (!popElement(node))
+			bad = true;
+		else if (xmlTextReaderDepth(reader) == 0)
+			endRoot();
+		break;
+	case XML_READER_TYPE_TEXT:
+	case XML_READER_TYPE_CDATA:
+		if (!checkTree(node))
+			bad = true;
+		break;
+	default:
+		break;
+	}
+	return !bad;
+}
+
+void XMLStream::endRoot()
+{
+	if (!bad && whenValid) {
+		whenValid();
+		whenValid = std::function<void()>();
+	}
+}
+
+/*
+ * libxml2 has marked its push-validation calls deprecated since 2.12. The
+ * suggested replacement, validating in the reader with XML_PARSE_DTDVALID,
+ * only checks a document against the DTD named in its <!DOCTYPE>, and our
+ * data files carry none: the caller picks the DTD. Until libxml2 offers
+ * another way, the deprecated calls stay in these wrappers and the warning
+ * is silenced here only.
+ */
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+static bool validatePushElement(xmlValidCtxt* valid, xmlDoc* doc,
+                                xmlNode* node)
+{
+	return xmlValidatePushElement(valid, doc, node, node->name) != 0;
+}
+
+static bool validatePopElement(xmlValidCtxt* valid, xmlDoc* doc,
+                               xmlNode* node)
+{
+	return xmlValidatePopElement(valid, doc, node, node->name) != 0;
+}
+
+static bool validateAttribute(xmlValidCtxt* valid, xmlDoc* doc,
+                              xmlNode* node, xmlAttr* attr,
+                              const xmlChar* value)
+{
+	return xmlValidateOneAttribute(valid, doc, node, attr, value) != 0;
+}
+
+static bool validateCData(xmlValidCtxt* valid, const xmlChar* content)
+{
+	return xmlValidatePushCData(valid, content, xmlStrlen(content)) != 0;
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+bool XMLStream::pushElement(xmlNode* node)
+{
+	return validatePushElement(valid, dtdDoc, node) &&
+	       checkAttributes(node);
+}
+
+bool XMLStream::popElement(xmlNode* node)
+{
+	return validatePopElement(valid, dtdDoc, node);
+}
+
+//! Check an element's attributes against its declaration, including
+//! that none of the required ones are missing.
+bool XMLStream::checkAttributes(xmlNode* node)
+{
+	xmlElement* decl = xmlGetDtdElementDesc(dtd, node->name);
+	if (!decl)
+		return false;
+
+	bool ok = true;
+	for (xmlAttr* a = node->properties; a; a = a->next) {
+		xmlChar* value = xmlNodeListGetString(node->doc, a->children, 1);
+		if (!validateAttribute(valid, dtdDoc, node, a, value))
+			ok = false;
+		xmlFree(value);
+	}
+	for (xmlAttribute* a = decl->attributes; a; a = a->nexth) {
+		if (a->def == XML_ATTRIBUTE_REQUIRED &&
+		    !xmlHasProp(node, a->name)) {
+			Log::err(path_, std::string("<") +
+			         (const char*)node->name + ">: missing " +
+			         (const char*)a->name + " attribute");
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+//! Check a node the reader won't visit, and everything in it.
+bool XMLStream::checkTree(xmlNode* node)
+{
+	switch (node->type) {
+	case XML_ELEMENT_NODE: {
+		if (!pushElement(node))
+			return false;
+		for (xmlNode* child = node->children; child; child = child->next)
+			if (!checkTree(child))
+				return false;
+		return popElement(node);
+	}
+	case XML_TEXT_NODE:
+	case XML_CDATA_SECTION_NODE: {
+		const xmlChar* content = node->content ? node->content :
+		                                         BAD_CAST("");
+		return validateCData(valid, content);
+	}
+	default:
+		return true;
+	}
+}
+
@@ -27,21 +27,28 @@
 #ifndef XML_H
 #define XML_H
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <libxml/tree.h>
+#include <libxml/valid.h>
+#include <libxml/xmlreader.h>
 
 #ifndef LIBXML_TREE_ENABLED
 	#error Tree must be enabled in libxml2
 #endif
 
-class XMLDoc;
+#ifndef LIBXML_REGEXP_ENABLED
+	#error Regexps must be enabled in libxml2 to validate while streaming
+#endif
 
 class XMLNode {
 public:
 	XMLNode();
-	XMLNode(XMLDoc* doc, xmlNode* node);
+	//! path names the document in error messages.
+	XMLNode(const std::string* path, xmlNode* node);
 
 	XMLNode childrenNode() const;
 	XMLNode next() const;
@@ -61,13 +68,15 @@ public:
 	operator bool() const;
 
 private:
-	XMLDoc* doc;
+	const std::string* path;
 	xmlNode* node;
 };
 
 class XMLDoc {
 public:
 	XMLDoc();
+	//! A NULL dtd means the data is already known to be valid, and it
+	//! isn't checked.
 	bool init(const std::string& path,
 	          const std::string& data,
 	          xmlDtd* dtd);
@@ -93,5 +102,88 @@ private:
 
 typedef std::shared_ptr<XMLDoc> XMLRef;
 
+/**
+ * Reads a document in one pass with libxml2's xmlTextReader. Unlike XMLDoc,
+ * no tree is built for the whole document. Only the element being read is
+ * held in memory, which keeps large documents with long runs of small
+ * elements cheap.
+ *
+ * Each element is checked against the DTD as it is read. The checks are
+ * the ones XMLDoc makes on a whole tree: the element's attributes, and its
+ * place in its parent's content model.
+ */
+class XMLStream {
+public:
+	XMLStream();
+	~XMLStream();
+
+	//! Start reading data, which is copied. As with XMLDoc, a NULL dtd
+	//! means nothing is checked.
+	bool init(const std::string& path,
+	          const std::string& data,
+	          xmlDtd* dtd);
+
+	//! Call fn once the end of the root element is read and the whole
+	//! document has been found valid.
+	void onValid(std::function<void()> fn);
+
+	/**
+	 * Move to the next element at depth, which must be one deeper than
+	 * the element being read. The root is at depth 0. Anything left in
+	 * the current element is read past. Returns false once the parent
+	 * ends, or on an error, which failed() tells apart.
+	 */
+	bool nextElement(int depth);
+
+	bool is(const char* name) const;
+
+	std::string attr(const std::string& name) const;
+	bool intAttr(const std::string& name, int* i) const;
+
+	//! The current element and everything in it as a tree, valid until
+	//! the stream moves on.
+	XMLNode expand();
+
+	//! Like expand(), but the tree lasts as long as the stream.
+	XMLNode keep();
+
+	//! The current element's text.
+	std::string text();
+
+	//! Whether the document turned out unreadable or invalid.
+	bool failed() const;
+
+	const std::string& path() const;
+
+private:
+	bool advance();
+	bool pushElement(xmlNode* node);
+	bool popElement(xmlNode* node);
+	bool checkAttributes(xmlNode* node);
+	bool checkTree(xmlNode* node);
+	//! The root element has ended. Is the document valid?
+	void endRoot();
+
+	std::string path_;
+	std::string data;
+	xmlDtd* dtd;
+
+	xmlTextReader* reader;
+	xmlValidCtxt* valid;
+	//! Stands in for the document being read when looking up the DTD.
+	xmlDoc* dtdDoc;
+
+	//! The current node was read past by nextElement() on behalf of the
+	//! caller's next move.
+	bool unread;
+	//! The current element has been expanded, and will be skipped over.
+	bool expanded;
+	bool bad;
+
+	std::function<void()> whenValid;
+
+	std::vector<xmlNode*> kept;
+};
+
 #endif
 